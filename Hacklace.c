@@ -8,7 +8,8 @@
 Title:				Hacklace - A necklace for hackers
 
 Hardware:			Hacklace-Board with ATtiny4313 running at 4 MHz and a
-					5 x 7 dot matrix display.
+					5 x 7 dot matrix display. The ATmega328P is supported as
+					well (see hal.h).
 Author:				Frank Andre
 License:			This software is distributed under the creative commons license
 					CC-BY-NC-SA.
@@ -34,8 +35,10 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
 #include <avr/eeprom.h>
 #include <avr/sleep.h>
 #include <util/delay.h>
-#include "config.h"
+#include <util/atomic.h>
+#include "hal.h"
 #include "dot_matrix.h"
+#include "config.h"
 #include "animations.h"
 
 
@@ -45,9 +48,9 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
 
 FUSES =
 {
-	.low = 0xE2,
-	.high = 0xDF,
-	.extended = 0xFF,
+	.low = FUSE_LOW,
+	.high = FUSE_HIGH,
+	.extended = FUSE_EXTENDED,
 };
 
 
@@ -60,6 +63,38 @@ volatile uint8_t button = PB_ACK;			// button event
 //uint8_t* msg_ptr = (uint8_t*) messages;		// pointer to next message in EEPROM
 uint8_t* msg_ptr;							// pointer to next message in EEPROM
 uint8_t* ee_write_ptr = (uint8_t*) messages;
+#ifdef SERIAL_REPORT
+volatile uint8_t report_request = 0;		// 1 = send status report
+#endif
+#ifdef MEASURE_LATENCY
+volatile uint8_t sys_ticks = 0;				// system timer cycles (wrapping around)
+volatile uint8_t press_ticks;				// value of sys_ticks at last button release
+uint8_t latency = 0;						// system timer cycles from last short button press to first frame of new message
+#endif
+#ifdef DISP_PREFETCH
+volatile uint8_t prefetch_state = 0;		// see prefetch states below (0 = PF_TODO)
+uint8_t* prefetch_ptr;						// pointer to message after the prefetched one
+uint8_t prefetch_mode;						// mode byte of the prefetched message
+#endif
+#ifdef DISP_VSCROLL
+uint8_t vscroll_speed = 8;					// vertical scrolling speed (0 = fastest)
+#endif
+#ifdef DISP_LAYERS
+uint8_t bg_speed;							// background scrolling speed (0 = fastest)
+#endif
+#ifdef REFRESH_GOVERNOR
+volatile uint8_t column_time = OCR0A_CYCLE_TIME;	// column period in timer 0 ticks (see SetRefreshRate)
+uint8_t fixed_column_time = 0;				// column period set over the serial interface (0 = automatic)
+#endif
+#ifdef MEASURE_ISR
+volatile uint16_t isr_cycles = 0;			// peak duration of the display interrupt since the last report
+#endif
+#ifdef DISP_RING
+uint8_t* render_msg;						// message that is rendered into the ring buffer
+uint8_t* render_adr;						// pointer to next item of the message
+const uint8_t* render_image;				// animation that is being rendered (0 = none)
+uint8_t render_direct;						// 1 = direct mode
+#endif
 
 
 /*************
@@ -71,13 +106,56 @@ uint8_t* ee_write_ptr = (uint8_t*) messages;
 #define RESET			2
 #define DISP_SET_MODE	3
 #define DISP_CHAR		4
-#define EE_NORMAL		5
-#define EE_SPECIAL_CHAR	6
-#define EE_HEX_CODE		7
+#define SET_BRIGHTNESS	5
+#define SET_ORIENTATION	6
+#define SET_MATRIX		7
+#define SET_RATE		8
+#define EE_NORMAL		9		// all states from here on echo the received character
+#define EE_SPECIAL_CHAR	10
+#define EE_HEX_CODE		11
 
 #define AUTH1_CHAR		'H'
 #define EE_AUTH2_CHAR	'L'		// authentication for entering EEPROM mode
 #define DISP_AUTH2_CHAR	'D'		// authentication for entering DISPLAY mode
+#define BRIGHT_AUTH2_CHAR	'B'	// authentication for setting the brightness
+#define INFO_AUTH2_CHAR	'I'		// authentication for requesting a status report
+#define ORIENT_AUTH2_CHAR	'O'	// authentication for setting the display orientation
+#define MATRIX_AUTH2_CHAR	'M'	// authentication for setting the dot matrix type and polarity
+#define RATE_AUTH2_CHAR	'R'		// authentication for setting the column period
+
+// prefetch states
+#define PF_TODO			0		// next message has to be prefetched
+#define PF_READY		1		// next message has been prefetched
+#define PF_FAILED		2		// next message does not fit into the free display memory
+
+// duration of the hand-tuned display interrupt including interrupt response and vector jump
+#ifdef DISP_FAST_ISR
+	#define FAST_ISR_BASE_CYCLES	145
+	#ifdef DISP_ORIENTATION_TABLES
+		#define FAST_ISR_ORIENT_CYCLES	6
+	#else
+		#define FAST_ISR_ORIENT_CYCLES	0
+	#endif
+	#ifdef DISP_RUNTIME_MATRIX
+		#define FAST_ISR_TABLE_CYCLES	(-9)
+	#else
+		#define FAST_ISR_TABLE_CYCLES	0
+	#endif
+	#ifdef REFRESH_GOVERNOR
+		#define FAST_ISR_RATE_CYCLES	2
+	#else
+		#define FAST_ISR_RATE_CYCLES	0
+	#endif
+	#if defined(DISP_ANTI_GHOST) && defined(DISP_RUNTIME_MATRIX)
+		#define FAST_ISR_GHOST_CYCLES	12
+	#elif defined(DISP_ANTI_GHOST)
+		#define FAST_ISR_GHOST_CYCLES	16
+	#else
+		#define FAST_ISR_GHOST_CYCLES	0
+	#endif
+	#define FAST_ISR_CYCLES	(FAST_ISR_BASE_CYCLES + FAST_ISR_ORIENT_CYCLES + FAST_ISR_TABLE_CYCLES + \
+							 FAST_ISR_RATE_CYCLES + FAST_ISR_GHOST_CYCLES)
+#endif
 
 
 /**********
@@ -105,6 +183,8 @@ uint8_t* ee_write_ptr = (uint8_t*) messages;
 ======================================================================*/
 void InitHardware(void)
 {
+	CLOCK_INIT();						// 4 MHz system clock (see hal.h)
+
 	// switch all pins that are connected to the dot matrix to output
 	DDRA = DISP_MASK_A;
 	DDRB = DISP_MASK_B;
@@ -114,13 +194,23 @@ void InitHardware(void)
 	PORTA |= ~DISP_MASK_A;
 	PORTB |= ~DISP_MASK_B;
 	PORTD |= ~DISP_MASK_D;
+
+	#ifdef DISP_SHIFT_OUT
+	// shift register extension (all pins low)
+	SR_DATA_DDR |= (1<<SR_DATA);
+	SR_DATA_PORT &= ~(1<<SR_DATA);
+	SR_CLOCK_DDR |= (1<<SR_CLOCK);
+	SR_CLOCK_PORT &= ~(1<<SR_CLOCK);
+	SR_LATCH_DDR |= (1<<SR_LATCH);
+	SR_LATCH_PORT &= ~(1<<SR_LATCH);
+	#endif
 	
 	// timer 0
 	TCCR0A = (0<<WGM00);				// timer mode = normal
-	TCCR0B = (5<<CS00);					// prescaler = 1:1024
-	OCR0A = OCR0A_CYCLE_TIME;
+	TCCR0B = (T0_CLK_SELECT<<CS00);		// prescaler = 1:1024 (1:256 in grayscale mode)
+	OCR0A = COLUMN_TIME;
 	OCR0B = OCR0B_CYCLE_TIME;
-	TIMSK |= (1<<OCIE0B)|(1<<OCIE0A);
+	TIMER0_IMSK |= (1<<OCIE0B)|(1<<OCIE0A);
 	
 	// serial interface
 	// Note: Speed of the serial interface must not be higher than 2400 Baud.
@@ -132,9 +222,38 @@ void InitHardware(void)
 	UBRRH = 0;
 	UCSRB = (1<<RXCIE)|(1<<RXEN);		// enable receiver, enable RX interrupt
 	UCSRC = (3<<UCSZ0);					// async USART, 8 data bits, no parity, 1 stop bit
+
+	#if defined(DISP_BRIGHTNESS) || defined(REFRESH_GOVERNOR) || defined(MEASURE_ISR)
+	// timer 1 (brightness control or measurement of the display interrupt)
+	TCCR1A = 0;							// timer mode = normal
+	TCCR1B = (1<<CS10);					// prescaler = 1:1
+	#endif
 }
 
 
+#ifdef REFRESH_GOVERNOR
+/*======================================================================
+	Function:		SetRefreshRate
+	Input:			none
+	Output:			none
+	Description:	Set the column period according to the scrolling speed unless
+					a fixed column period has been set over the serial interface.
+======================================================================*/
+void SetRefreshRate(void)
+{
+	uint8_t t;
+
+	t = fixed_column_time;
+	if (t == 0) {
+		if (scroll_speed <= GOV_FAST_SPEED)			{ t = COLUMN_TIME_FAST; }
+		else if (scroll_speed >= GOV_SLOW_SPEED)	{ t = COLUMN_TIME_SLOW; }
+		else										{ t = OCR0A_CYCLE_TIME; }
+	}
+	column_time = t;
+}
+#endif
+
+
 /*======================================================================
 	Function:		SetMode
 	Input:			mode byte
@@ -143,29 +262,101 @@ void InitHardware(void)
 					The mode byte is interpreted as follows:
 					Bit 7:		reverse scrolling direction (0 = no, always scroll forward, 1 = yes, bidirectional scrolling)
 					Bit 6..4:	delay between scrolling repetitions (0 = shortest, 7 = longest)
-					Bit 3:		scrolling increment (cleared = +1 (for texts), set = +5 (for animations))
+					Bit 3:		scrolling increment (cleared = +1 (for texts), set = +DISP_COLUMNS (one animation frame))
+								With padding texts that scroll forward only come in from the edge
+								and leave it again.
 					Bit 2..0:	scrolling speed (1 = slowest, 7 = fastest)
 ======================================================================*/
 void SetMode(uint8_t mode)
 {
 	uint8_t inc, dir, dly, spd;
 
-	if (mode & 0x08)	{ inc = 5; }
+	if (mode & 0x08)	{ inc = DISP_COLUMNS; }
 		else			{ inc = 1; }
 	if (mode & 0x80)	{ dir = BIDIRECTIONAL; }
 		else			{ dir = FORWARD; }
 	spd = mode & 0x07;
 	dly = swap(mode) & 0x07;
 	dmSetScrolling(inc, dir, pgm_read_byte(&dly_conv[dly]));
+	#ifdef DISP_PAD
+	if ((inc == 1) && (dir == FORWARD))	{ dmSetPadding(PAD_COLUMNS); }
+		else		{ dmSetPadding(0); }		// keep animation frames in place, bounce at the content edges
+	#endif
 	scroll_speed = pgm_read_byte(&spd_conv[spd]);
+	#ifdef REFRESH_GOVERNOR
+	SetRefreshRate();
+	#endif
 }		
 
 
+#ifdef DISP_VSCROLL
 /*======================================================================
-	Function:		DisplayMessage
-	Input:			pointer to zero terminated message data in EEPROM memory
+	Function:		SetVScrolling
+	Input:			pointer to the speed and delay digits in EEPROM memory
+					escape character ('^' = up, '_' = down)
+	Output:			pointer to the character after the digits
+	Description:	Set vertical scrolling from an escape sequence of a message.
+					Speed and delay are converted like those of the mode byte.
+======================================================================*/
+uint8_t* SetVScrolling(uint8_t* ee_adr, uint8_t dir)
+{
+	uint8_t spd, dly;
+
+	spd = eeprom_read_byte(ee_adr++) & 0x07;		// '0'..'7' -> 0..7
+	dly = eeprom_read_byte(ee_adr++) & 0x07;
+	if (dir == '^')	{ dir = VSCROLL_UP; }
+		else		{ dir = VSCROLL_DOWN; }
+	dmSetVScrolling(dir, pgm_read_byte(&dly_conv[dly]));
+	vscroll_speed = pgm_read_byte(&spd_conv[spd]);
+	return (ee_adr);
+}
+#endif
+
+
+#ifdef DISP_LAYERS
+/*======================================================================
+	Function:		SetBackground
+	Input:			pointer to the speed and increment digits in EEPROM memory
+					index of the animation
+	Output:			pointer to the character after the digits
+	Description:	Set the background layer from an escape sequence of a message.
+					The speed is converted like that of the mode byte, the increment
+					is '0' (still), '1' (one column) or '2' (one animation frame).
+======================================================================*/
+uint8_t* SetBackground(uint8_t* ee_adr, uint8_t index)
+{
+	uint8_t spd, inc;
+
+	spd = eeprom_read_byte(ee_adr++) & 0x07;		// '0'..'7' -> 0..7
+	inc = eeprom_read_byte(ee_adr++) & 0x03;
+	if (inc > 1) { inc = DISP_COLUMNS; }
+	bg_speed = pgm_read_byte(&spd_conv[spd]);
+	dmSetBackground((const uint8_t*)pgm_read_word(&animation[index]), inc);
+	return (ee_adr);
+}
+#endif
+
+
+#ifdef DISP_BRIGHTNESS
+/*======================================================================
+	Function:		SetBrightness
+	Input:			brightness level (0 = darkest, 15 = full brightness)
+	Output:			none
+	Description:	Set display brightness.
+======================================================================*/
+void SetBrightness(uint8_t level)
+{
+	dmSetBrightness(pgm_read_byte(&bright_conv[level & 0x0F]));
+}
+#endif
+
+
+/*======================================================================
+	Function:		RenderMessage
+	Input:			pointer to the text of a message in EEPROM memory (after the mode byte)
 	Output:			pointer to next message
-	Description:	Show a message (i. e. text or animation) on the display.
+	Description:	Render a message (i. e. text or animation) into the display memory
+					at the current cursor position.
 
 					Escape characters:
 
@@ -175,38 +366,78 @@ void SetMode(uint8_t mode)
 					To enter a '^' character simply double it: '^^'
 
 					Character '~' followed by an upper case letter is used
-					to insert (animation) data from flash.
+					to insert (animation) data from flash. In grayscale mode
+					'~' followed by a digit inserts a grayscale animation.
+					With layers enabled '~' followed by a lower case letter
+					followed by two digits for speed ('0'..'7', as in the
+					mode byte) and increment ('0' = still, '1' = one column,
+					'2' = one frame) shows the animation as background
+					(e. g. '~a42'), '~*' inverts the
+					background behind the text and '~#' cuts the text out
+					of the background.
+					With attributes enabled '~!' starts or ends inverted
+					text and '~=' starts or ends blinking text.
+					With vertical scrolling enabled '~^' (up) or '~_' (down)
+					followed by two digits for speed and delay (as in the
+					mode byte, '0'..'7') lets the message roll vertically.
+					Unlike characters and animations these settings are not
+					followed by a narrow space.
 					
 					The character 0xFF is used to enter direct mode in which 
 					the following bytes are directly written to the display 
 					memory without being decoded using the character font.
 					Direct mode is ended by 0xFF.
 ======================================================================*/
-uint8_t* DisplayMessage(uint8_t* ee_adr)
+#ifndef DISP_RING
+uint8_t* RenderMessage(uint8_t* ee_adr)
 {
-	uint8_t ch;
-
-	SetMode(eeprom_read_byte(ee_adr));
-	ee_adr++;
-	dmClearDisplay();
+	uint8_t ch, space;
 
 	ch = eeprom_read_byte(ee_adr++);
 	while (ch) {
+		space = 1;
 		if (ch == '~') {					// animation
 			ch = eeprom_read_byte(ee_adr++);
 			if (ch != '~') {
+				#ifdef DISP_ATTRIBUTES
+				if (ch == '!') { dmMarkAttribute(ATTR_INVERT);  space = 0; }
+				if (ch == '=') { dmMarkAttribute(ATTR_BLINK(BLINK_RATE));  space = 0; }
+				#endif
+				#ifdef DISP_VSCROLL
+				if ((ch == '^') || (ch == '_')) { ee_adr = SetVScrolling(ee_adr, ch);  space = 0; }
+				#endif
 				ch -= 'A';
 				if (ch < ANIMATION_COUNT) {
 					dmDisplayImage((const uint8_t*)pgm_read_word(&animation[ch]));
 				}				
+				#ifdef DISP_GRAYSCALE
+				ch += 'A' - '0';			// '0'..'9' -> grayscale animations
+				if (ch < GRAY_ANIMATION_COUNT) {
+					dmDisplayGrayImage((const uint8_t*)pgm_read_word(&gray_animation[ch]));
+				}
+				#endif
+				#ifdef DISP_LAYERS
+				ch += 'A' - 'a';			// 'a'..'z' -> background
+				if (ch < ANIMATION_COUNT) {
+					ee_adr = SetBackground(ee_adr, ch);
+					space = 0;
+				}
+				ch += 'a';
+				if (ch == '*') { dmSetLayerMode(LAYER_XOR);  space = 0; }
+				if (ch == '#') { dmSetLayerMode(LAYER_MASK);  space = 0; }
+				#endif
 			}
 		}
 		else if (ch == 0xFF) {				// direct mode
+			#ifdef DISP_SOURCES
+			ee_adr = dmDisplayEEImage(ee_adr);
+			#else
 			ch = eeprom_read_byte(ee_adr++);
 			while (ch != 0xFF) {
 				dmPrintByte(ch);
 				ch = eeprom_read_byte(ee_adr++);
 			}
+			#endif
 		}
 		else {								// character
 			if (ch == '^') {				// special character
@@ -218,7 +449,36 @@ uint8_t* DisplayMessage(uint8_t* ee_adr)
 			dmPrintChar(ch);
 		}
 		ch = eeprom_read_byte(ee_adr++);
-		if (ch) { dmPrintByte(0); }			// print a narrow space except for the last character					
+		if (ch && space) { dmPrintByte(0); }	// print a narrow space except for the last character and settings
+	}
+	ch = eeprom_read_byte(ee_adr);			// read mode byte of next message
+	if (ch)		{ return(ee_adr); }
+		else	{ return((uint8_t*) messages); }	// restart all-over if mode byte is 0
+}
+
+#else
+/*======================================================================
+	Function:		SkipMessage
+	Input:			pointer to the text of a message in EEPROM memory (after the mode byte)
+	Output:			pointer to next message
+	Description:	Find the next message without rendering the message
+					(see RenderMessage for the escape characters).
+======================================================================*/
+uint8_t* SkipMessage(uint8_t* ee_adr)
+{
+	uint8_t ch;
+
+	ch = eeprom_read_byte(ee_adr++);
+	while (ch) {
+		if ((ch == '~') || (ch == '^')) {	// skip escaped character
+			ee_adr++;
+		}
+		else if (ch == 0xFF) {				// skip direct mode data
+			do {
+				ch = eeprom_read_byte(ee_adr++);
+			} while (ch != 0xFF);
+		}
+		ch = eeprom_read_byte(ee_adr++);
 	}
 	ch = eeprom_read_byte(ee_adr);			// read mode byte of next message
 	if (ch)		{ return(ee_adr); }
@@ -226,6 +486,317 @@ uint8_t* DisplayMessage(uint8_t* ee_adr)
 }
 
 
+/*======================================================================
+	Function:		StartRender
+	Input:			pointer to zero terminated message data in EEPROM memory
+	Output:			none
+	Description:	Start rendering a message into the ring buffer (see RenderAhead).
+======================================================================*/
+void StartRender(uint8_t* ee_adr)
+{
+	render_msg = ee_adr;
+	render_adr = ee_adr + 1;
+	render_image = 0;
+	render_direct = 0;
+	if (eeprom_read_byte(render_adr))	{ dmSetRingState(RING_FILL); }
+	else								{ dmSetRingState(RING_COMPLETE); }	// empty message
+}
+
+
+/*======================================================================
+	Function:		RenderStep
+	Input:			none
+	Output:			none
+	Description:	Render the next item of a message into the ring buffer, i. e. a
+					character including the following narrow space, a column of an
+					animation, a byte of direct mode data or a setting (without a
+					narrow space). This needs at most
+					CHAR_WIDTH + 1 columns. The items are the same as those of 
+					RenderMessage.
+======================================================================*/
+void RenderStep(void)
+{
+	uint8_t ch, space = 1;
+
+	if (render_image) {						// animation
+		ch = pgm_read_byte(render_image++);
+		if (ch != 0xFF) { dmPrintByte(ch);  return; }
+		render_image = 0;
+	}
+	else if (render_direct) {				// direct mode
+		ch = eeprom_read_byte(render_adr++);
+		if (ch != 0xFF) { dmPrintByte(ch);  return; }
+		render_direct = 0;
+	}
+	else {
+		ch = eeprom_read_byte(render_adr++);
+		if (ch == '~') {					// animation
+			ch = eeprom_read_byte(render_adr++);
+			if (ch != '~') {
+				#ifdef DISP_VSCROLL
+				if ((ch == '^') || (ch == '_')) { render_adr = SetVScrolling(render_adr, ch);  space = 0; }
+				#endif
+				ch -= 'A';
+				if (ch < ANIMATION_COUNT) {
+					render_image = (const uint8_t*)pgm_read_word(&animation[ch]);
+					return;
+				}
+				#ifdef DISP_LAYERS
+				ch += 'A' - 'a';			// 'a'..'z' -> background
+				if (ch < ANIMATION_COUNT) {
+					render_adr = SetBackground(render_adr, ch);
+					space = 0;
+				}
+				ch += 'a';
+				if (ch == '*') { dmSetLayerMode(LAYER_XOR);  space = 0; }
+				if (ch == '#') { dmSetLayerMode(LAYER_MASK);  space = 0; }
+				#endif
+			}
+		}
+		else if (ch == 0xFF) {				// direct mode
+			render_direct = 1;
+			return;
+		}
+		else {								// character
+			if (ch == '^') {				// special character
+				ch = eeprom_read_byte(render_adr++);
+				if (ch != '^') {
+					ch += 63;
+				}
+			}
+			dmPrintChar(ch);
+		}
+	}
+	// item completed
+	if (eeprom_read_byte(render_adr) == 0)	{ dmSetRingState(RING_COMPLETE); }
+	else if (space)							{ dmPrintByte(0); }		// print a narrow space except for the last character and settings
+}
+
+
+/*======================================================================
+	Function:		RenderAhead
+	Input:			none
+	Output:			none
+	Description:	Fill the ring buffer with the following items of the message
+					and start over if the scrolling has requested it.
+					The serial receive interrupt is held back meanwhile as it may
+					write to the display. The receiver buffers up to two characters.
+======================================================================*/
+void RenderAhead(void)
+{
+	UCSRB &= ~(1<<RXCIE);					// hold back serial receive interrupt
+	if (dmRingState() == RING_REFILL) { StartRender(render_msg); }
+	while ((dmRingState() == RING_FILL) && (dmRingFree() > CHAR_WIDTH)) {
+		RenderStep();
+	}
+	UCSRB |= (1<<RXCIE);
+}
+#endif
+
+
+#ifdef DISP_TEXT_MODE
+/*======================================================================
+	Function:		IsText
+	Input:			pointer to the text of a message in EEPROM memory (after the mode byte)
+	Output:			1 = message consists of characters only, 0 = otherwise
+	Description:	Check whether a message can be shown in text mode, i. e. it
+					contains neither animations nor direct mode data.
+======================================================================*/
+uint8_t IsText(uint8_t* ee_adr)
+{
+	uint8_t ch;
+
+	do {
+		ch = eeprom_read_byte(ee_adr++);
+		if ((ch == '~') || (ch == 0xFF)) { return (0); }
+	} while (ch);
+	return (1);
+}
+#endif
+
+
+/*======================================================================
+	Function:		DisplayMessage
+	Input:			pointer to zero terminated message data in EEPROM memory
+	Output:			pointer to next message
+	Description:	Show a message (i. e. text or animation) on the display.
+======================================================================*/
+uint8_t* DisplayMessage(uint8_t* ee_adr)
+{
+	dmBeginUpdate();						// switch off display while rendering
+	SetMode(eeprom_read_byte(ee_adr));
+	#ifdef DISP_TEXT_MODE
+	if (IsText(ee_adr + 1))	{ dmSetTextMode(); }
+	else
+	#endif
+	dmClearDisplay();
+	#ifdef DISP_ENERGY_CAP
+	dmReadEnergy(1);						// count energy per message
+	#endif
+	#ifdef DISP_RING
+	StartRender(ee_adr);
+	RenderAhead();							// render the first part of the message
+	ee_adr = SkipMessage(ee_adr + 1);
+	#else
+	ee_adr = RenderMessage(ee_adr + 1);
+	#endif
+	dmCommit();								// show new message with the next frame
+	return (ee_adr);
+}
+
+
+#ifdef DISP_PREFETCH
+/*======================================================================
+	Function:		PrefetchMessage
+	Input:			pointer to zero terminated message data in EEPROM memory
+	Output:			none
+	Description:	Render a message into the free display memory so that it can
+					be shown without delay by ShowPrefetchedMessage.
+					The serial receive interrupt is held back meanwhile as it may
+					write to the display. The receiver buffers up to two characters.
+======================================================================*/
+void PrefetchMessage(uint8_t* ee_adr)
+{
+	uint8_t state = PF_FAILED;
+
+	UCSRB &= ~(1<<RXCIE);					// hold back serial receive interrupt
+	if (dmBeginPrefetch()) {
+		prefetch_mode = eeprom_read_byte(ee_adr);
+		prefetch_ptr = RenderMessage(ee_adr + 1);
+		if (dmEndPrefetch()) { state = PF_READY; }
+	}
+	prefetch_state = state;
+	UCSRB |= (1<<RXCIE);
+}
+
+
+/*======================================================================
+	Function:		ShowPrefetchedMessage
+	Input:			none
+	Output:			pointer to next message
+	Description:	Show the message rendered by PrefetchMessage.
+					The serial receive interrupt is held back while waiting for
+					the end of the frame, as it may change the display memory.
+					If it has already done so, the next message is rendered
+					instead.
+======================================================================*/
+uint8_t* ShowPrefetchedMessage(void)
+{
+	UCSRB &= ~(1<<RXCIE);					// hold back serial receive interrupt
+	if (prefetch_state != PF_READY) {		// prefetched message discarded meanwhile?
+		UCSRB |= (1<<RXCIE);
+		return (DisplayMessage(msg_ptr));
+	}
+	dmFlip();								// show new message with the next frame
+	SetMode(prefetch_mode);
+	UCSRB |= (1<<RXCIE);
+	#ifdef DISP_ENERGY_CAP
+	dmReadEnergy(1);						// count energy per message
+	#endif
+	return (prefetch_ptr);
+}
+#endif
+
+
+#ifdef SERIAL_REPORT
+/*======================================================================
+	Function:		SerialSend
+	Input:			character
+	Output:			none
+	Description:	Send a character over the serial interface.
+======================================================================*/
+void SerialSend(uint8_t ch)
+{
+	while ((UCSRA & (1<<UDRE)) == 0) {}		// wait until transmit buffer is empty
+	UDR = ch;
+}
+
+
+/*======================================================================
+	Function:		SerialSendHex
+	Input:			value
+					number of hex digits
+	Output:			none
+	Description:	Send the lower digits of a value as hex number.
+======================================================================*/
+void SerialSendHex(uint32_t val, uint8_t digits)
+{
+	uint8_t ch;
+
+	while (digits) {
+		digits--;
+		ch = (val >> (digits << 2)) & 0x0F;
+		if (ch > 9) { ch += ('A' - '9' - 1); }
+		SerialSend(ch + '0');
+	}
+}
+
+
+/*======================================================================
+	Function:		SendReport
+	Input:			none
+	Output:			none
+	Description:	Send a status report over the serial interface.
+					Every value is preceded by a letter:
+					E = led-milliseconds since start of the current message (energy cap)
+					L = system timer cycles from last short button press to first frame
+					    of the new message
+					F = column frequency [Hz]
+					C = peak duration of the display interrupt since the last report [cycles]
+					U = load caused by the display interrupt [0.1 %] (within the short
+					    phase in grayscale mode)
+					S = peak duration of a shift-out per module column since the last
+					    report [cycles]
+					The report is terminated by <CR><LF>.
+					Note: The transmitter pin TXD (PD1) is connected to the dot matrix.
+					It is used by the transmitter only while the report is sent.
+======================================================================*/
+void SendReport(void)
+{
+	#if defined(REFRESH_GOVERNOR) || defined(MEASURE_ISR)
+	uint16_t cycles;
+	uint8_t t;
+	#endif
+
+	UCSRA = (1<<TXC);						// clear transmit complete flag
+	UCSRB |= (1<<TXEN);						// enable transmitter
+	#ifdef DISP_ENERGY_CAP
+	SerialSend('E');
+	SerialSendHex(dmReadEnergy(0) / (F_CPU / 16000), 8);
+	#endif
+	#ifdef MEASURE_LATENCY
+	SerialSend('L');
+	SerialSendHex(latency, 2);
+	#endif
+	#if defined(REFRESH_GOVERNOR) || defined(MEASURE_ISR)
+	t = COLUMN_TIME;
+	#ifdef MEASURE_ISR
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		cycles = isr_cycles;
+		isr_cycles = 0;
+	}
+	#else
+	cycles = FAST_ISR_CYCLES;				// counted from the instructions
+	#endif
+	SerialSend('F');
+	SerialSendHex(F_CPU / T0_PRESCALER / t, 4);
+	SerialSend('C');
+	SerialSendHex(cycles, 4);
+	SerialSend('U');
+	SerialSendHex((uint32_t) cycles * 1000 / ((uint16_t) T0_PRESCALER * ISR_PERIOD), 4);
+	#endif
+	#ifdef SHIFT_REPORT
+	SerialSend('S');
+	SerialSendHex((dmReadShiftCycles(1) + (DISP_WIDTH - DISP_COLUMNS) / 2) / (DISP_WIDTH - DISP_COLUMNS), 2);
+	#endif
+	SerialSend(13);
+	SerialSend(10);
+	while ((UCSRA & (1<<TXC)) == 0) {}		// wait until last character has been sent
+	UCSRB &= ~(1<<TXEN);					// give pin back to the dot matrix
+}
+#endif
+
+
 /*======================================================================
 	Function:		GoToSleep
 	Input:			none
@@ -238,7 +809,7 @@ void GoToSleep(void)
 	dmClearDisplay();
 	_delay_ms(1000);
 	GIFR = (1<<PCIF2);				// clear interrupt flag
-	PCMSK2 = (1<<PCINT17);			// enable pin change interrupt
+	PCMSK2 = (1<<PB_BIT);			// enable pin change interrupt
 	GIMSK = (1<<PCIE2);				// enable pin change interrupt
 	set_sleep_mode(SLEEP_MODE_PWR_DOWN);
 	sleep_mode();
@@ -255,8 +826,28 @@ void GoToSleep(void)
 
 int main(void)
 {
+	#ifdef EE_SETTINGS
+	uint8_t setting;
+	#endif
+
 	InitHardware();
 	dmInit();
+	// settings out of range (e. g. erased EEPROM) are replaced by the defaults
+	#ifdef DISP_BRIGHTNESS
+	setting = eeprom_read_byte(&settings.brightness);
+	if (setting > 15) { setting = DEFAULT_BRIGHTNESS; }
+	SetBrightness(setting);
+	#endif
+	#ifdef DISP_RUNTIME_MATRIX
+	setting = eeprom_read_byte(&settings.matrix);
+	if (setting > (MATRIX_HDSP5403 | MATRIX_ANODE)) { setting = DISP_MATRIX; }
+	dmSetMatrix(setting);
+	#endif
+	#ifdef DISP_ORIENTATION
+	setting = eeprom_read_byte(&settings.orientation);
+	if (setting > ORIENT_ROTATE) { setting = ORIENT_NORMAL; }
+	dmSetOrientation(setting);
+	#endif
 	sei();									// enable interrupts
 
 	GoToSleep();
@@ -265,7 +856,18 @@ int main(void)
 	while(1)
 	{
 		if (button == PB_RELEASE) {			// short button press
-			msg_ptr = DisplayMessage(msg_ptr);
+			#ifdef DISP_PREFETCH
+			if (prefetch_state == PF_READY)	{ msg_ptr = ShowPrefetchedMessage(); }
+			else
+			#endif
+			{ msg_ptr = DisplayMessage(msg_ptr); }
+			#ifdef MEASURE_LATENCY
+			while (DISP_FLAGS & (1<<DISP_BLANK)) {}		// wait for first frame of new message
+			latency = sys_ticks - press_ticks;
+			#endif
+			#ifdef DISP_PREFETCH
+			prefetch_state = PF_TODO;
+			#endif
 			button |= PB_ACK;
 		}
 		
@@ -274,9 +876,29 @@ int main(void)
 			dmPrintChar(130);				// sad smiley
 			_delay_ms(500);
 			GoToSleep();
+			#ifdef DISP_PREFETCH
+			prefetch_state = PF_TODO;
+			#endif
 			button |= PB_ACK;
 		}
 		
+		#ifdef SERIAL_REPORT
+		if (report_request) {
+			SendReport();
+			report_request = 0;
+		}
+		#endif
+
+		#ifdef DISP_PREFETCH
+		if (prefetch_state == PF_TODO) {	// render next message in idle time
+			PrefetchMessage(msg_ptr);
+		}
+		#endif
+
+		#ifdef DISP_RING
+		RenderAhead();						// refill the ring buffer behind the visible window
+		#endif
+		
 	} // of while(1)
 }
 
@@ -285,23 +907,263 @@ int main(void)
  * interrupt service routines *
  ******************************/
 
+#ifdef DISP_FAST_ISR
+
+#ifdef DISP_RUNTIME_MATRIX
+	#define LD_TABLE	"ld		"			// output tables in RAM (2 cycles)
+#else
+	#define LD_TABLE	"lpm	"			// output tables in flash (3 cycles)
+#endif
+
+ISR(TIMER0_COMPA_vect, ISR_NAKED)
+// display interrupt (hand-tuned version of dmDisplay)
+// The current column is kept in GPIOR1 and the window base in GPIOR2. All branches
+// take the same number of cycles so that every call needs exactly 139 cycles
+// including reti (plus 6 cycles for the interrupt response and the vector jump).
+// DISP_ORIENTATION adds 6 cycles. DISP_RUNTIME_MATRIX saves 9 cycles as the output
+// tables are read from RAM (ld) instead of flash (lpm). REFRESH_GOVERNOR adds 2 cycles
+// for reading the column period from RAM. DISP_ANTI_GHOST adds 16 cycles (12 cycles
+// with DISP_RUNTIME_MATRIX) for switching off the ports B and D (see FAST_ISR_CYCLES).
+// MEASURE_ISR reads timer 1 after saving and before restoring the registers and keeps
+// the peak difference in isr_cycles. This adds 22 to 25 cycles, so the duration is no
+// longer fixed while it is measured.
+// The output tables are the same as those used by dmSetOutputs in dot_matrix.c.
+{
+	asm volatile (
+		"push	r24"						"\n\t"	// save registers		19 cycles
+		"in		r24, __SREG__"				"\n\t"
+		"push	r24"						"\n\t"
+		"push	r25"						"\n\t"
+		"push	r18"						"\n\t"
+		"push	r19"						"\n\t"
+		"push	r20"						"\n\t"
+		"push	r21"						"\n\t"
+		"push	r30"						"\n\t"
+		"push	r31"						"\n\t"
+		#ifdef MEASURE_ISR
+		"push	r22"						"\n\t"	// start of measurement (6 cycles)
+		"push	r23"						"\n\t"
+		"in		r22, %[tcntl]"				"\n\t"	// low byte first
+		"in		r23, %[tcnth]"				"\n\t"
+		#endif
+
+		"in		r24, %[ocr]"				"\n\t"	// setup next cycle		3 cycles
+		#ifdef REFRESH_GOVERNOR
+		"lds	r25, column_time"			"\n\t"	// runtime column period (2 cycles)
+		"add	r24, r25"					"\n\t"
+		#else
+		"subi	r24, -(%[cycle])"			"\n\t"
+		#endif
+		"out	%[ocr], r24"				"\n\t"
+
+		"in		r25, %[col]"				"\n\t"	// next column			13 cycles
+		"inc	r25"						"\n\t"
+		"cpi	r25, %[cols]"				"\n\t"
+		"brlo	1f"							"\n\t"
+		"ldi	r25, 0"						"\n\t"	// start of frame:
+		"sbic	%[flags], %[hold]"			"\n\t"	// latch hold request (5 cycles)
+		"sbi	%[flags], %[blank]"			"\n\t"
+		"sbis	%[flags], %[hold]"			"\n\t"
+		"cbi	%[flags], %[blank]"			"\n\t"
+		"rjmp	2f"							"\n\t"
+	"1:	rjmp	.+0"						"\n\t"	// same number of cycles
+		"rjmp	.+0"						"\n\t"
+		"rjmp	.+0"						"\n\t"
+		"nop"								"\n\t"
+	"2:	out		%[col], r25"				"\n\t"
+
+		"cpi	r25, %[cols] - 1"			"\n\t"	// end of frame?		5 cycles
+		"breq	3f"							"\n\t"
+		"nop"								"\n\t"
+		"rjmp	4f"							"\n\t"
+	"3:	sbi		%[flags], %[sync]"			"\n\t"
+
+	"4:	in		r30, %[base]"				"\n\t"	// read pattern			9 cycles
+		"add	r30, r25"					"\n\t"
+		"ldi	r31, 0"						"\n\t"
+		"subi	r30, lo8(-(display))"		"\n\t"
+		"sbci	r31, hi8(-(display))"		"\n\t"
+		"ld		r24, Z"						"\n\t"
+		"sbic	%[flags], %[blank]"			"\n\t"	// display switched off?
+		"ldi	r24, 0"						"\n\t"
+
+		"mov	r30, r24"					"\n\t"	// rows 1..4			17 cycles
+		"andi	r30, 0x0F"					"\n\t"
+		"mov	r21, r30"					"\n\t"
+		"lsl	r30"						"\n\t"
+		"add	r30, r21"					"\n\t"
+		#ifdef DISP_ORIENTATION_TABLES
+		"sbic	%[flags], %[flip]"			"\n\t"	// flipped rows (2 cycles)
+		"subi	r30, -(16 * 3)"				"\n\t"
+		#endif
+		"ldi	r31, 0"						"\n\t"
+		"subi	r30, lo8(-(row_lo))"		"\n\t"
+		"sbci	r31, hi8(-(row_lo))"		"\n\t"
+		LD_TABLE "r18, Z+"				"\n\t"
+		LD_TABLE "r19, Z+"				"\n\t"
+		LD_TABLE "r20, Z"					"\n\t"
+
+		"swap	r24"						"\n\t"	// rows 5..7			20 cycles
+		"andi	r24, 0x07"					"\n\t"
+		"mov	r30, r24"					"\n\t"
+		"lsl	r30"						"\n\t"
+		"add	r30, r24"					"\n\t"
+		#ifdef DISP_ORIENTATION_TABLES
+		"sbic	%[flags], %[flip]"			"\n\t"	// flipped rows (2 cycles)
+		"subi	r30, -(8 * 3)"				"\n\t"
+		#endif
+		"ldi	r31, 0"						"\n\t"
+		"subi	r30, lo8(-(row_hi))"		"\n\t"
+		"sbci	r31, hi8(-(row_hi))"		"\n\t"
+		LD_TABLE "r21, Z+"				"\n\t"
+		"or		r18, r21"					"\n\t"
+		LD_TABLE "r21, Z+"				"\n\t"
+		"or		r19, r21"					"\n\t"
+		LD_TABLE "r21, Z"					"\n\t"
+		"or		r20, r21"					"\n\t"
+
+		"mov	r30, r25"					"\n\t"	// inactive columns		18 cycles
+		"lsl	r30"						"\n\t"
+		"add	r30, r25"					"\n\t"
+		#ifdef DISP_ORIENTATION_TABLES
+		"sbic	%[flags], %[mirror]"		"\n\t"	// mirrored columns (2 cycles)
+		"subi	r30, -((%[cols] + 1) * 3)"	"\n\t"
+		#endif
+		"ldi	r31, 0"						"\n\t"
+		"subi	r30, lo8(-(col_out))"		"\n\t"
+		"sbci	r31, hi8(-(col_out))"		"\n\t"
+		LD_TABLE "r21, Z+"				"\n\t"
+		"or		r18, r21"					"\n\t"
+		LD_TABLE "r21, Z+"				"\n\t"
+		"or		r19, r21"					"\n\t"
+		LD_TABLE "r21, Z"					"\n\t"
+		"or		r20, r21"					"\n\t"
+
+		#ifdef DISP_ANTI_GHOST
+		#ifdef DISP_RUNTIME_MATRIX
+		"lds	r24, all_off + 1"			"\n\t"	// switch off ports B and D (12 cycles)
+		"lds	r25, all_off + 2"			"\n\t"
+		#else
+		"ldi	r30, lo8(all_off + 1)"		"\n\t"	// switch off ports B and D (16 cycles)
+		"ldi	r31, hi8(all_off + 1)"		"\n\t"
+		"lpm	r24, Z+"					"\n\t"
+		"lpm	r25, Z"						"\n\t"
+		#endif
+		"in		r21, %[portb]"				"\n\t"
+		"andi	r21, %[keep_b]"				"\n\t"
+		"or		r21, r24"					"\n\t"
+		"out	%[portb], r21"				"\n\t"
+		"in		r21, %[portd]"				"\n\t"
+		"andi	r21, %[keep_d]"				"\n\t"
+		"or		r21, r25"					"\n\t"
+		"out	%[portd], r21"				"\n\t"
+		#endif
+
+		"in		r21, %[porta]"				"\n\t"	// set outputs			12 cycles
+		"andi	r21, %[keep_a]"				"\n\t"
+		"or		r21, r18"					"\n\t"
+		"out	%[porta], r21"				"\n\t"
+		"in		r21, %[portb]"				"\n\t"
+		"andi	r21, %[keep_b]"				"\n\t"
+		"or		r21, r19"					"\n\t"
+		"out	%[portb], r21"				"\n\t"
+		"in		r21, %[portd]"				"\n\t"
+		"andi	r21, %[keep_d]"				"\n\t"
+		"or		r21, r20"					"\n\t"
+		"out	%[portd], r21"				"\n\t"
+
+		#ifdef MEASURE_ISR
+		"in		r30, %[tcntl]"				"\n\t"	// end of measurement (16 to 19 cycles)
+		"in		r31, %[tcnth]"				"\n\t"
+		"sub	r30, r22"					"\n\t"
+		"sbc	r31, r23"					"\n\t"
+		"lds	r22, isr_cycles"			"\n\t"	// keep the peak value
+		"lds	r23, isr_cycles + 1"		"\n\t"
+		"cp		r22, r30"					"\n\t"
+		"cpc	r23, r31"					"\n\t"
+		"brsh	5f"							"\n\t"
+		"sts	isr_cycles + 1, r31"		"\n\t"
+		"sts	isr_cycles, r30"			"\n\t"
+	"5:	pop		r23"						"\n\t"
+		"pop	r22"						"\n\t"
+		#endif
+		"pop	r31"						"\n\t"	// restore registers	19 cycles
+		"pop	r30"						"\n\t"
+		"pop	r21"						"\n\t"
+		"pop	r20"						"\n\t"
+		"pop	r19"						"\n\t"
+		"pop	r18"						"\n\t"
+		"pop	r25"						"\n\t"
+		"pop	r24"						"\n\t"
+		"out	__SREG__, r24"				"\n\t"
+		"pop	r24"						"\n\t"
+		"reti"						 					// 4 cycles
+		:
+		: [ocr]    "I" (_SFR_IO_ADDR(OCR0A)),
+		  [cycle]  "M" (OCR0A_CYCLE_TIME),
+		  [col]    "I" (_SFR_IO_ADDR(GPIOR1)),
+		  [base]   "I" (_SFR_IO_ADDR(GPIOR2)),
+		  [cols]   "M" (DISP_COLUMNS),
+		  [flags]  "I" (_SFR_IO_ADDR(DISP_FLAGS)),
+		  [sync]   "I" (DISP_SYNC),
+		  [hold]   "I" (DISP_HOLD),
+		  [blank]  "I" (DISP_BLANK),
+		  [flip]   "I" (DISP_FLIP),
+		  [mirror] "I" (DISP_MIRROR),
+		  [porta]  "I" (_SFR_IO_ADDR(PORTA)),
+		  [portb]  "I" (_SFR_IO_ADDR(PORTB)),
+		  [portd]  "I" (_SFR_IO_ADDR(PORTD)),
+		  [keep_a] "M" ((uint8_t) ~DISP_MASK_A),
+		  [keep_b] "M" ((uint8_t) ~DISP_MASK_B),
+		  [keep_d] "M" ((uint8_t) ~DISP_MASK_D),
+		  [tcntl]  "I" (_SFR_IO_ADDR(TCNT1L)),
+		  [tcnth]  "I" (_SFR_IO_ADDR(TCNT1H))
+	);
+}
+
+#else
+
 ISR(TIMER0_COMPA_vect)
 // display interrupt
 {
-	OCR0A += OCR0A_CYCLE_TIME;				// setup next cycle
+	#ifdef MEASURE_ISR
+	uint16_t t = TCNT1;
+	#endif
+
+#ifdef DISP_GRAYSCALE
+	if (dmDisplay())	{ OCR0A += OCR0A_SHORT_TIME; }	// short phase of current column
+	else				{ OCR0A += OCR0A_LONG_TIME; }	// long phase of next column
+#else
+	OCR0A += COLUMN_TIME;					// setup next cycle
 
 	dmDisplay();							// show next column on dot matrix display
+#endif
+	#ifdef MEASURE_ISR
+	t = TCNT1 - t;							// measure duration (without register frame)
+	if (t > isr_cycles) { isr_cycles = t; }
+	#endif
 }
 
+#endif
+
 
 ISR(TIMER0_COMPB_vect)
 // system timer interrupt
 {
 	static uint8_t scroll_timer = 1;
+	#ifdef DISP_VSCROLL
+	static uint8_t vscroll_timer = 1;
+	#endif
+	#ifdef DISP_LAYERS
+	static uint8_t bg_timer = 1;
+	#endif
 	static uint8_t pb_timer = 0;			// push button timer
 	uint8_t temp;
 		
 	OCR0B += OCR0B_CYCLE_TIME;				// setup next cycle
+	#ifdef MEASURE_LATENCY
+	sys_ticks++;
+	#endif
 
 	if (scroll_timer) {
 		scroll_timer--;
@@ -310,6 +1172,24 @@ ISR(TIMER0_COMPB_vect)
 		scroll_timer = scroll_speed;		// restart timer
 		dmScroll();							// do a scrolling step
 	}
+	#ifdef DISP_VSCROLL
+	if (vscroll_timer) {
+		vscroll_timer--;
+	}
+	else {
+		vscroll_timer = vscroll_speed;
+		dmScrollVertical();
+	}
+	#endif
+	#ifdef DISP_LAYERS
+	if (bg_timer) {
+		bg_timer--;
+	}
+	else {
+		bg_timer = bg_speed;
+		dmScrollBackground();
+	}
+	#endif
 	
 	// push button sampling
 	temp = ~PB_PIN;							// sample push button
@@ -317,6 +1197,9 @@ ISR(TIMER0_COMPB_vect)
 	if (temp == 0) {						// --- button not pressed ---
 		if (button & PB_PRESS) {			// former state = pressed?
 			button &= ~(PB_PRESS | PB_ACK);	// -> issue release event
+			#ifdef MEASURE_LATENCY
+			press_ticks = sys_ticks;
+			#endif
 		}
 	}
 	else {									// --- button pressed ---
@@ -354,6 +1237,9 @@ ISR(USART0_RX_vect)
 
 	if (UCSRA & (1<<FE)) { return; }	// framing error? -> return
 	ch = UDR;							// read received character
+	#ifdef DISP_PREFETCH
+	prefetch_state = PF_TODO;			// display memory or messages may change
+	#endif
 	if (ch == 27) { state = RESET; }	// <ESC> resets the state machine
 	if (state >= EE_NORMAL) {
 		dmClearDisplay();
@@ -368,6 +1254,21 @@ ISR(USART0_RX_vect)
 		case AUTH:
 			if (ch == EE_AUTH2_CHAR)		{ state = EE_NORMAL; }
 			else if (ch == DISP_AUTH2_CHAR)	{ state = DISP_SET_MODE; }
+			#ifdef DISP_BRIGHTNESS
+			else if (ch == BRIGHT_AUTH2_CHAR)	{ state = SET_BRIGHTNESS; }
+			#endif
+			#ifdef DISP_ORIENTATION
+			else if (ch == ORIENT_AUTH2_CHAR)	{ state = SET_ORIENTATION; }
+			#endif
+			#ifdef DISP_RUNTIME_MATRIX
+			else if (ch == MATRIX_AUTH2_CHAR)	{ state = SET_MATRIX; }
+			#endif
+			#ifdef REFRESH_GOVERNOR
+			else if (ch == RATE_AUTH2_CHAR)	{ state = SET_RATE; }
+			#endif
+			#ifdef SERIAL_REPORT
+			else if (ch == INFO_AUTH2_CHAR)	{ report_request = 1;  state = IDLE; }
+			#endif
 			else							{ state = IDLE; }
 			break;
 		case RESET:
@@ -386,6 +1287,48 @@ ISR(USART0_RX_vect)
 			if ((ch == 13) || (ch == 10)) {	dmClearDisplay(); }		// chr(13) = <CR>, chr(10) = <LF>
 			else { dmPrintChar(ch); dmPrintByte(0); }				// print character followed by empty column
 			break;
+		#ifdef DISP_BRIGHTNESS
+		case SET_BRIGHTNESS:
+			if (ch >= 'A') { ch -= ('A' - '9' - 1); }
+			ch -= '0';								// map characters '0'..'9' and 'A'..'F' to values 0..15
+			if (ch <= 15) {
+				SetBrightness(ch);
+				eeprom_write_byte(&settings.brightness, ch);
+			}
+			state = IDLE;
+			break;
+		#endif
+		#ifdef DISP_ORIENTATION
+		case SET_ORIENTATION:
+			ch -= '0';								// '0' = normal, '1' = mirrored, '2' = flipped, '3' = rotated
+			if (ch <= ORIENT_ROTATE) {
+				dmSetOrientation(ch);
+				eeprom_write_byte(&settings.orientation, ch);
+			}
+			state = IDLE;
+			break;
+		#endif
+		#ifdef DISP_RUNTIME_MATRIX
+		case SET_MATRIX:
+			ch -= '0';								// '0' = Tx07-11, '1' = HDSP5403, +2 = common column anode
+			if (ch <= (MATRIX_HDSP5403 | MATRIX_ANODE)) {
+				dmSetMatrix(ch);
+				eeprom_write_byte(&settings.matrix, ch);
+			}
+			state = IDLE;
+			break;
+		#endif
+		#ifdef REFRESH_GOVERNOR
+		case SET_RATE:
+			if (ch >= 'A') { ch -= ('A' - '9' - 1); }
+			ch -= '0';								// '0' = automatic, '2'..'F' = column period in timer 0 ticks
+			if ((ch <= 15) && (ch != 1)) {			// a single tick is shorter than the display interrupt may take
+				fixed_column_time = ch;
+				SetRefreshRate();
+			}
+			state = IDLE;
+			break;
+		#endif
 		case EE_NORMAL:
 			if (ch == '^') { state = EE_SPECIAL_CHAR; }
 			else if (ch == '$') { val = 0;  state = EE_HEX_CODE; }
@@ -413,12 +1356,17 @@ ISR(USART0_RX_vect)
 }
 
 
-/*
+#ifdef DISP_BRIGHTNESS
 ISR(TIMER1_COMPA_vect)
+// brightness interrupt (switch off the current column when its on-time has elapsed)
 {
+	TIMER1_IMSK &= ~(1<<OCIE1A);
+	dmBlank();
 }
+#endif
 
 
+/*
 ISR(TIMER1_COMPB_vect)
 {
 }
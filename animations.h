@@ -93,5 +93,19 @@ const animation_t animation[] PROGMEM = {	arrow,
 #define ANIMATION_COUNT	(sizeof(animation)/sizeof(animation[0]))
 
 
+#ifdef DISP_GRAYSCALE
+
+// Grayscale animations use two bytes per column (see dmDisplayGrayImage).
+#include "animations/ripple.h"
+
+// list of all grayscale animations
+const animation_t gray_animation[] PROGMEM = {	ripple
+											};
+
+#define GRAY_ANIMATION_COUNT	(sizeof(gray_animation)/sizeof(gray_animation[0]))
+
+#endif
+
+
 
 #endif /* ANIMATIONS_H_ */
\ No newline at end of file
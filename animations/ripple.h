@@ -0,0 +1,10 @@
+const unsigned char ripple[] PROGMEM = {
+	0x00, 0x00, 0x00, 0x1C, 0x08, 0x1C, 0x00, 0x1C, 0x00, 0x00, 	// frame 1
+	0x00, 0x1C, 0x1C, 0x2A, 0x1C, 0x36, 0x1C, 0x2A, 0x00, 0x1C, 	// frame 2
+	0x1C, 0x2A, 0x3E, 0x41, 0x36, 0x63, 0x3E, 0x41, 0x1C, 0x2A, 	// frame 3
+	0x7F, 0x22, 0x63, 0x14, 0x63, 0x41, 0x63, 0x14, 0x7F, 0x22, 	// frame 4
+	0x63, 0x5D, 0x41, 0x22, 0x41, 0x22, 0x41, 0x22, 0x63, 0x5D, 	// frame 5
+	0x00, 0x41, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x41, 	// frame 6
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 	// frame 7
+	END_OF_DATA
+};
@@ -41,12 +41,77 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
 // timing
 #define COLUMN_FREQ			1000		// display column frequency [Hz]
 #define SYS_TIMER_FREQ		100			// system timer frequency [Hz]
-#define OCR0A_CYCLE_TIME	(uint8_t)(F_CPU / 1024.0 / COLUMN_FREQ + 0.5);
-#define OCR0B_CYCLE_TIME	(uint8_t)(F_CPU / 1024.0 / SYS_TIMER_FREQ + 0.5);
+#ifdef DISP_GRAYSCALE
+	#define T0_PRESCALER	256			// finer resolution for the grayscale phases
+	#define T0_CLK_SELECT	4			// clock select bits for prescaler 1:256
+#else
+	#define T0_PRESCALER	1024
+	#define T0_CLK_SELECT	5			// clock select bits for prescaler 1:1024
+#endif
+#define OCR0A_CYCLE_TIME	(uint8_t)(F_CPU / (double)T0_PRESCALER / COLUMN_FREQ + 0.5)
+#define OCR0B_CYCLE_TIME	(uint8_t)(F_CPU / (double)T0_PRESCALER / SYS_TIMER_FREQ + 0.5)
+#define OCR0A_LONG_TIME		((OCR0A_CYCLE_TIME * 2 + 1) / 3)		// grayscale phases (2:1)
+#define OCR0A_SHORT_TIME	(OCR0A_CYCLE_TIME - OCR0A_LONG_TIME)
+
+// refresh rate governor
+// The column period is chosen per message from its scrolling speed: fast scrolling
+// is shown at a higher refresh rate to reduce flicker and stroboscopic effects, slow
+// or static messages at a lower rate to save CPU time. A fixed column period can be
+// set over the serial interface ('H' 'R'). Timer 1 measures the duration of the
+// display interrupt, which is sent with the status report together with the rate.
+//#define REFRESH_GOVERNOR					// if defined -> column period is adjusted at runtime
+#define COLUMN_TIME_FAST	2			// column period in timer 0 ticks for fast scrolling (1953 Hz at 4 MHz)
+#define COLUMN_TIME_SLOW	8			// column period in timer 0 ticks for slow scrolling (488 Hz at 4 MHz)
+#define GOV_FAST_SPEED		5			// scroll_speed up to which the fast rate is used
+#define GOV_SLOW_SPEED		18			// scroll_speed from which on the slow rate is used
+#if defined(REFRESH_GOVERNOR) && (defined(DISP_BRIGHTNESS) || defined(DISP_GRAYSCALE))
+	#error "REFRESH_GOVERNOR cannot be used with DISP_BRIGHTNESS or DISP_GRAYSCALE (on-times are fixed in cycles)"
+#endif
+#ifdef REFRESH_GOVERNOR
+	#define COLUMN_TIME		column_time			// see Hacklace.c
+#else
+	#define COLUMN_TIME		OCR0A_CYCLE_TIME
+#endif
+
+// interrupt measurement
+// Timer 1 measures the duration of the display interrupt (without the register frame).
+// The peak value is sent with the status report ('H' 'I') together with the column
+// frequency and the load caused by the display interrupt. The refresh rate governor
+// measures it unless the hand-tuned display interrupt is used, whose fixed duration
+// is reported instead (see FAST_ISR_CYCLES in Hacklace.c). Measuring the hand-tuned
+// interrupt makes it 22 to 25 cycles longer.
+//#define MEASURE_ISR						// if defined -> measure the duration of the display interrupt
+#if defined(REFRESH_GOVERNOR) && !defined(DISP_FAST_ISR)
+	#define MEASURE_ISR
+#endif
+#ifdef DISP_GRAYSCALE
+	#define ISR_PERIOD		OCR0A_SHORT_TIME	// shortest period of the display interrupt in timer 0 ticks
+#else
+	#define ISR_PERIOD		COLUMN_TIME
+#endif
+
+// padding (DISP_PAD)
+#define PAD_COLUMNS			DISP_WINDOW		// blank columns before and after scrolling text
+
+// attributes (DISP_ATTRIBUTES)
+#define BLINK_RATE			2			// blink rate of blinking text (1 = slowest, 4 = fastest)
 
 // serial interface
 #define SER_CLK_CORRECTION	1.101		// factor to correct the serial baud rate
 
+// latency measurement
+//#define MEASURE_LATENCY					// if defined -> measure time from short button press to first frame of the new message
+
+// shift-out duration, measured if timer 1 is running
+#if defined(DISP_SHIFT_OUT) && (defined(DISP_BRIGHTNESS) || defined(REFRESH_GOVERNOR) || defined(MEASURE_ISR))
+	#define SHIFT_REPORT
+#endif
+
+// serial status report ('H' 'I'), available if there is anything to report
+#if defined(DISP_ENERGY_CAP) || defined(MEASURE_LATENCY) || defined(REFRESH_GOVERNOR) || defined(MEASURE_ISR) || defined(SHIFT_REPORT)
+	#define SERIAL_REPORT
+#endif
+
 // push button
 #define PB_PORT				PORTD
 #define PB_PIN				PIND
@@ -61,8 +126,28 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
 #define PB_LONGPRESS		(PB_PRESS|PB_LONG)
 #define PB_MASK				(1<<PB_BIT)				// mask to extract button state
 
+// settings in EEPROM (only for the features that can be set over the serial interface)
+#if defined(DISP_BRIGHTNESS) || defined(DISP_ORIENTATION) || defined(DISP_RUNTIME_MATRIX)
+	#define EE_SETTINGS
+	typedef struct {
+		#ifdef DISP_BRIGHTNESS
+		uint8_t brightness;			// brightness level (0 = darkest, 15 = full brightness)
+		#endif
+		#ifdef DISP_ORIENTATION
+		uint8_t orientation;		// display orientation (see ORIENT_NORMAL etc. in dot_matrix.h)
+		#endif
+		#ifdef DISP_RUNTIME_MATRIX
+		uint8_t matrix;				// dot matrix type and polarity (see MATRIX_HDSP5403 and MATRIX_ANODE in dot_matrix.h)
+		#endif
+	} settings_t;
+	#define SETTINGS_SIZE	sizeof(settings_t)
+#else
+	#define SETTINGS_SIZE	0
+#endif
+#define DEFAULT_BRIGHTNESS	15			// brightness at first start or after the EEPROM has been erased
+
 // messages in EEPROM
-#define MSG_SIZE	256			// number of EEPROM bytes reserved for messages
+#define MSG_SIZE	(E2END + 1 - SETTINGS_SIZE)	// number of EEPROM bytes reserved for messages
 
 // default message data
 // A message is either a text or an animation to be displayed on the dot matrix.
@@ -70,16 +155,25 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
 //		0x20 = normal space (3+1 columns)
 //		0x7F = short space (0+1 column)
 //		0x9D = long space (5+1 columns), may be used as the last frame of an animation
+// LEAD and TRAIL are the spaces that let a text scroll in and out. With padding they
+// are not needed (see DISP_PAD).
+#ifdef DISP_PAD
+	#define LEAD
+	#define TRAIL
+#else
+	#define LEAD			' ',
+	#define TRAIL			0x9D,
+#endif
 const uint8_t messages[MSG_SIZE] EEMEM = {
 	0x54, 'H', 'a', 'c', 'k', 'l', 'a', 'c', 'e', ' ', '^', 'P', 0x00, 
-	0x44, ' ', 'n', 'u', 'r', ' ', '1', '0', '^', 'A', 0x9D, 0x00,
-	0x64, ' ', 'K', 'a', 'u', 'f', ' ', 'm', 'i', 'c', 'h', 0x7F, '!', '!', '!', 0x9D, 0x00,
-	0x65, ' ', 'I', ' ', '^', 'R', ' ', 'R', 'a', 'u', 'm', 'Z', 'e', 'i', 't', 'L', 'a', 'b', 'o', 'r', 0x9D, 0x00,
+	0x44, LEAD 'n', 'u', 'r', ' ', '1', '0', '^', 'A', TRAIL 0x00,
+	0x64, LEAD 'K', 'a', 'u', 'f', ' ', 'm', 'i', 'c', 'h', 0x7F, '!', '!', '!', TRAIL 0x00,
+	0x65, LEAD 'I', ' ', '^', 'R', ' ', 'R', 'a', 'u', 'm', 'Z', 'e', 'i', 't', 'L', 'a', 'b', 'o', 'r', TRAIL 0x00,
 	0xC4, 0x8B, ' ', 0x8C, ' ', 0x8E, ' ', 0x8D, 0x00,							// Monster
-	0x44, ' ', '^', 'm', ' ', '+', ' ', '^', 'n', ' ', '=', ' ', '^', 'R', 0x00,
+	0x44, LEAD '^', 'm', ' ', '+', ' ', '^', 'n', ' ', '=', ' ', '^', 'R', 0x00,
 	0x0B, 0xA3, ' ', 0xA5, ' ', 0xA6, ' ', 0xA0, ' ', 0x00,						// break-dance
-	0x04, ' ', '^', 'S', '^', 'S', '^', 'S', 0x9D, 0x00,						// turn left
-	0x04, ' ', 0x94, 0x95, 0x95, ' ',  0x94, ' ', 0x95, 0x7F, 0x94, 0x9D, 0x00,	// music
+	0x04, LEAD '^', 'S', '^', 'S', '^', 'S', TRAIL 0x00,						// turn left
+	0x04, LEAD 0x94, 0x95, 0x95, ' ',  0x94, ' ', 0x95, 0x7F, 0x94, TRAIL 0x00,	// music
 	0x95, ' ', '|', ' ', 0x00,			// scan
 	0x6C, '~', 'A', 0x00,				// arrow
 	0x0D, '~', 'B', 0x00,				// fire
@@ -109,10 +203,30 @@ const uint8_t messages[MSG_SIZE] EEMEM = {
 	0x00
 };
 
+// default settings
+#ifdef EE_SETTINGS
+settings_t settings EEMEM = {
+	#ifdef DISP_BRIGHTNESS
+	DEFAULT_BRIGHTNESS,			// brightness
+	#endif
+	#ifdef DISP_ORIENTATION
+	ORIENT_NORMAL,				// orientation
+	#endif
+	#ifdef DISP_RUNTIME_MATRIX
+	DISP_MATRIX					// dot matrix type and polarity
+	#endif
+};
+#endif
+
 // speed and delay conversion
 // Convert speed / delay parameters from mode byte (range 0..7) to actual speed / delay values.
 const uint8_t dly_conv[] PROGMEM = {0, 1, 2, 3, 5, 8, 13, 21};
 const uint8_t spd_conv[] PROGMEM = {50, 30, 18, 11, 7, 5, 3, 2};
 
+// brightness conversion
+// Convert brightness level (range 0..15) to column on-time in units of 16 cycles (0 = always on).
+// Note: The column period is F_CPU / COLUMN_FREQ cycles, i. e. 250 units at 4 MHz and 1 kHz.
+const uint8_t bright_conv[] PROGMEM = {1, 2, 3, 4, 6, 8, 11, 16, 22, 32, 45, 64, 90, 128, 180, 0};
+
 
 #endif /* CONFIG_H_ */
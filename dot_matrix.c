@@ -29,6 +29,8 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
 #include <avr/eeprom.h>
+#include <util/atomic.h>
+#include "hal.h"
 #include "dot_matrix.h"
 #include "Font_5x7_extended.h"
 
@@ -37,41 +39,435 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
  * global variables *
  ********************/
 
+// Output tables
+// The output tables translate a column pattern into the values of the ports A, B and D
+// so that the display interrupt does not have to assemble the port values bit by bit.
+// The lower nibble of a pattern (rows 1..4) is looked up in row_lo[], the upper bits
+// (rows 5..8) are looked up in row_hi[] and the bits that switch off all columns except
+// the current one are looked up in col_out[]. ORing the three entries of a port gives
+// the port value. The last entry of col_out[] switches off all columns.
+// All tables are generated at compile time from the connection map in dot_matrix.h.
+// Note: Rows and columns use disjoint port bits, so the inversion for displays with
+// common column anode can be folded into the tables as well.
+// With DISP_ORIENTATION every table exists twice: The first half is used for the
+// mounting given by DISP_UPDOWN and the second half has the rows (row_lo[], row_hi[])
+// or the columns (col_out[]) in reverse order. The flags DISP_FLIP and DISP_MIRROR
+// select the half, so changing the orientation costs no time per pixel.
+// With DISP_RUNTIME_MATRIX the tables are built in RAM by dmBuildTables instead.
+// With DISP_ROW_SCAN the tables are transposed: row_sel[] switches on the current row
+// only (the last entry switches off all rows) and col_lit[] switches on the columns
+// given by a row pattern (bit 0 = column 1).
+// With DISP_ANTI_GHOST all_off[] holds the port values that switch off all rows and
+// columns. It does not depend on the orientation.
+
+// The tables are generated for DISP_ROWS rows and DISP_COLUMNS columns. ORS(n, f, x, y)
+// joins the terms f(1, x, y) .. f(n, x, y) by |, LIST(n, f, x) lists f(1, x) .. f(n, x).
+#define ORS(n, f, x, y)			ORS_(n, f, x, y)
+#define ORS_(n, f, x, y)		ORS##n(f, x, y)
+#define ORS1(f, x, y)			f(1, x, y)
+#define ORS2(f, x, y)			ORS1(f, x, y) | f(2, x, y)
+#define ORS3(f, x, y)			ORS2(f, x, y) | f(3, x, y)
+#define ORS4(f, x, y)			ORS3(f, x, y) | f(4, x, y)
+#define ORS5(f, x, y)			ORS4(f, x, y) | f(5, x, y)
+#define ORS6(f, x, y)			ORS5(f, x, y) | f(6, x, y)
+#define ORS7(f, x, y)			ORS6(f, x, y) | f(7, x, y)
+#define ORS8(f, x, y)			ORS7(f, x, y) | f(8, x, y)
+#define LIST(n, f, x)			LIST_(n, f, x)
+#define LIST_(n, f, x)			LIST##n(f, x)
+#define LIST1(f, x)				f(1, x)
+#define LIST2(f, x)				LIST1(f, x), f(2, x)
+#define LIST3(f, x)				LIST2(f, x), f(3, x)
+#define LIST4(f, x)				LIST3(f, x), f(4, x)
+#define LIST5(f, x)				LIST4(f, x), f(5, x)
+#define LIST6(f, x)				LIST5(f, x), f(6, x)
+#define LIST7(f, x)				LIST6(f, x), f(7, x)
+#define LIST8(f, x)				LIST7(f, x), f(8, x)
+
+#define ALL_ROWS				((1 << DISP_ROWS) - 1)
+#define ALL_COLS				((1 << DISP_COLUMNS) - 1)
+
+// port bits of the rows that are switched on in pattern pat (bit 0 = row 1)
+#define ROW(port, pat, i, r)	((((pat) >> (i)) & 1) && (r##_PORT == (port)) ? (1 << r) : 0)
+#define ROW_DOWN(k, port, pat)	ROW(port, pat, (k) - 1, R##k)
+#define ROW_UP(k, port, pat)	ROW(port, pat, DISP_ROWS - (k), R##k)
+#define ROWS_DOWN(port, pat)	(ORS(DISP_ROWS, ROW_DOWN, port, pat))
+#define ROWS_UP(port, pat)		(ORS(DISP_ROWS, ROW_UP, port, pat))
+
+// port bits of the columns that are switched off in pattern pat (bit 0 = column 1)
+#define COLUMN(port, pat, i, c)	((((pat) >> (i)) & 1) && (c##_PORT == (port)) ? (1 << c) : 0)
+#define COL_RIGHT(k, port, pat)	COLUMN(port, pat, (k) - 1, C##k)
+#define COL_LEFT(k, port, pat)	COLUMN(port, pat, DISP_COLUMNS - (k), C##k)
+#define COLS_RIGHT(port, pat)	(ORS(DISP_COLUMNS, COL_RIGHT, port, pat))
+#define COLS_LEFT(port, pat)	(ORS(DISP_COLUMNS, COL_LEFT, port, pat))
+
 #ifdef DISP_UPDOWN
-	const uint8_t col_port[] PROGMEM = {C5_PORT, C4_PORT, C3_PORT, C2_PORT, C1_PORT};
-	const uint8_t col_bit[]  PROGMEM = {(1<<C5), (1<<C4), (1<<C3), (1<<C2), (1<<C1)};
-	const uint8_t row_port[] PROGMEM = {R7_PORT, R6_PORT, R5_PORT, R4_PORT, R3_PORT, R2_PORT, R1_PORT};
-	const uint8_t row_bit[]  PROGMEM = {(1<<R7), (1<<R6), (1<<R5), (1<<R4), (1<<R3), (1<<R2), (1<<R1)};
+	#define ROW_BITS		ROWS_UP
+	#define ROW_BITS_FLIP	ROWS_DOWN
+	#define COL_BITS		COLS_LEFT
+	#define COL_BITS_MIRROR	COLS_RIGHT
+#else
+	#define ROW_BITS		ROWS_DOWN
+	#define ROW_BITS_FLIP	ROWS_UP
+	#define COL_BITS		COLS_RIGHT
+	#define COL_BITS_MIRROR	COLS_LEFT
+#endif
+
+#if DISP_TYPE == 1						// if we use a display with common column anode
+	#define POLARITY(bits, mask)	((bits) ^ (mask))		// -> invert outputs
+#else
+	#define POLARITY(bits, mask)	(bits)
+#endif
+
+#define ROW_LO(n, bits)	{ POLARITY(bits(A, n), bits(A, 0x0F)),					\
+						  POLARITY(bits(B, n), bits(B, 0x0F)),					\
+						  POLARITY(bits(D, n), bits(D, 0x0F)) }
+#define ROW_HI(n, bits)	{ POLARITY(bits(A, (n) << 4), bits(A, 0xF0)),			\
+						  POLARITY(bits(B, (n) << 4), bits(B, 0xF0)),			\
+						  POLARITY(bits(D, (n) << 4), bits(D, 0xF0)) }
+#define COL_LIT(n, bits){ POLARITY(bits(A, ALL_COLS & ~(n)), bits(A, ALL_COLS)),	\
+						  POLARITY(bits(B, ALL_COLS & ~(n)), bits(B, ALL_COLS)),	\
+						  POLARITY(bits(D, ALL_COLS & ~(n)), bits(D, ALL_COLS)) }
+#define COL_OUT(c, bits)	COL_LIT(COL_ON(c), bits)
+#define COL_OUT_K(k, bits)	COL_OUT((k) - 1, bits)
+#define COL_ON(c)		((c) < 0 ? 0 : 1 << (c))				// c = -1 -> no column
+#define ROW_SEL(r, bits){ POLARITY(bits(A, ROW_ON(r)), bits(A, ALL_ROWS)),		\
+						  POLARITY(bits(B, ROW_ON(r)), bits(B, ALL_ROWS)),		\
+						  POLARITY(bits(D, ROW_ON(r)), bits(D, ALL_ROWS)) }
+#define ROW_SEL_K(k, bits)	ROW_SEL((k) - 1, bits)
+#define ROW_ON(r)		((r) < 0 ? 0 : 1 << (r))				// r = -1 -> no row
+#define ALL_OFF(port)	(POLARITY(ROW_BITS(port, 0), ROW_BITS(port, ALL_ROWS)) | POLARITY(COL_BITS(port, ALL_COLS), COL_BITS(port, ALL_COLS)))
+
+#define ROW_LO_TABLE(bits)	{																			\
+	ROW_LO(0, bits),  ROW_LO(1, bits),  ROW_LO(2, bits),  ROW_LO(3, bits),  ROW_LO(4, bits),  ROW_LO(5, bits),	\
+	ROW_LO(6, bits),  ROW_LO(7, bits),  ROW_LO(8, bits),  ROW_LO(9, bits),  ROW_LO(10, bits), ROW_LO(11, bits),	\
+	ROW_LO(12, bits), ROW_LO(13, bits), ROW_LO(14, bits), ROW_LO(15, bits) }
+#define ROW_HI8(n, bits)																				\
+	ROW_HI(n, bits),     ROW_HI(n + 1, bits), ROW_HI(n + 2, bits), ROW_HI(n + 3, bits),						\
+	ROW_HI(n + 4, bits), ROW_HI(n + 5, bits), ROW_HI(n + 6, bits), ROW_HI(n + 7, bits)
+#if DISP_ROWS > 7
+	#define ROW_HI_COUNT		16			// rows 5..8
+	#define ROW_HI_TABLE(bits)	{ ROW_HI8(0, bits), ROW_HI8(8, bits) }
+#else
+	#define ROW_HI_COUNT		8			// rows 5..7
+	#define ROW_HI_TABLE(bits)	{ ROW_HI8(0, bits) }
+#endif
+#define COL_OUT_TABLE(bits)	{ LIST(DISP_COLUMNS, COL_OUT_K, bits), COL_OUT(-1, bits) }
+#define ROW_SEL_TABLE(bits)	{ LIST(DISP_ROWS, ROW_SEL_K, bits), ROW_SEL(-1, bits) }
+#define COL_LIT8(n, bits)																				\
+	COL_LIT(n, bits),     COL_LIT(n + 1, bits), COL_LIT(n + 2, bits), COL_LIT(n + 3, bits),					\
+	COL_LIT(n + 4, bits), COL_LIT(n + 5, bits), COL_LIT(n + 6, bits), COL_LIT(n + 7, bits)
+#define COL_LIT32(n, bits)	COL_LIT8(n, bits), COL_LIT8(n + 8, bits), COL_LIT8(n + 16, bits), COL_LIT8(n + 24, bits)
+#if DISP_COLUMNS > 7
+	#define COL_LIT_COUNT		256
+	#define COL_LIT_TABLE(bits)	{ COL_LIT32(0, bits), COL_LIT32(32, bits), COL_LIT32(64, bits), COL_LIT32(96, bits),		\
+								  COL_LIT32(128, bits), COL_LIT32(160, bits), COL_LIT32(192, bits), COL_LIT32(224, bits) }
+#elif DISP_COLUMNS > 6
+	#define COL_LIT_COUNT		128
+	#define COL_LIT_TABLE(bits)	{ COL_LIT32(0, bits), COL_LIT32(32, bits), COL_LIT32(64, bits), COL_LIT32(96, bits) }
+#elif DISP_COLUMNS > 5
+	#define COL_LIT_COUNT		64
+	#define COL_LIT_TABLE(bits)	{ COL_LIT32(0, bits), COL_LIT32(32, bits) }
+#else
+	#define COL_LIT_COUNT		32
+	#define COL_LIT_TABLE(bits)	{ COL_LIT32(0, bits) }
+#endif
+
+#ifdef DISP_RUNTIME_MATRIX
+uint8_t row_lo[16][3];
+uint8_t row_hi[8][3];
+uint8_t col_out[DISP_COLUMNS + 1][3];
+#ifdef DISP_ANTI_GHOST
+uint8_t all_off[3];
+#endif
+
+// connection maps of the supported dot matrix types (see dot_matrix.h)
+// Every pin is given by (port << 4) | bit. The rows 1..7 are followed by the columns 1..5.
+#define PIN(port, bit)	(((port) << 4) | (bit))
+const uint8_t pin_map[2][DISP_ROWS + DISP_COLUMNS] PROGMEM = {
+	{ PIN(B, 1), PIN(B, 2), PIN(D, 3), PIN(B, 4), PIN(A, 0), PIN(A, 1), PIN(D, 1),	// Tx07-11
+	  PIN(D, 4), PIN(D, 2), PIN(B, 3), PIN(B, 6), PIN(B, 5) },
+	{ PIN(B, 6), PIN(B, 5), PIN(A, 1), PIN(A, 0), PIN(D, 3), PIN(B, 2), PIN(B, 1),	// HDSP5403
+	  PIN(B, 3), PIN(B, 4), PIN(D, 4), PIN(D, 2), PIN(D, 1) }
+};
+#elif defined(DISP_ROW_SCAN) && defined(DISP_ORIENTATION_TABLES)
+const uint8_t row_sel[2][DISP_ROWS + 1][3] PROGMEM = { ROW_SEL_TABLE(ROW_BITS), ROW_SEL_TABLE(ROW_BITS_FLIP) };
+const uint8_t col_lit[2][COL_LIT_COUNT][3] PROGMEM = { COL_LIT_TABLE(COL_BITS), COL_LIT_TABLE(COL_BITS_MIRROR) };
+#elif defined(DISP_ROW_SCAN)
+const uint8_t row_sel[DISP_ROWS + 1][3] PROGMEM = ROW_SEL_TABLE(ROW_BITS);
+const uint8_t col_lit[COL_LIT_COUNT][3] PROGMEM = COL_LIT_TABLE(COL_BITS);
+#elif defined(DISP_ORIENTATION_TABLES)
+const uint8_t row_lo[2][16][3] PROGMEM = { ROW_LO_TABLE(ROW_BITS), ROW_LO_TABLE(ROW_BITS_FLIP) };
+const uint8_t row_hi[2][ROW_HI_COUNT][3] PROGMEM = { ROW_HI_TABLE(ROW_BITS), ROW_HI_TABLE(ROW_BITS_FLIP) };
+const uint8_t col_out[2][DISP_COLUMNS + 1][3] PROGMEM = { COL_OUT_TABLE(COL_BITS), COL_OUT_TABLE(COL_BITS_MIRROR) };
+#else
+const uint8_t row_lo[16][3] PROGMEM = ROW_LO_TABLE(ROW_BITS);
+const uint8_t row_hi[ROW_HI_COUNT][3] PROGMEM = ROW_HI_TABLE(ROW_BITS);
+const uint8_t col_out[DISP_COLUMNS + 1][3] PROGMEM = COL_OUT_TABLE(COL_BITS);
+#endif
+
+#if defined(DISP_ANTI_GHOST) && !defined(DISP_RUNTIME_MATRIX)
+const uint8_t all_off[3] PROGMEM = { ALL_OFF(A), ALL_OFF(B), ALL_OFF(D) };
+#endif
+#if defined(DISP_ANTI_GHOST) && (COLS_RIGHT(A, ALL_COLS) != 0)
+	#error "DISP_ANTI_GHOST expects the columns on the ports B and D"
+#endif
+
+#if defined(DISP_COMPENSATION) || defined(DISP_ENERGY_CAP)
+	// number of lit leds for every column pattern
+	#define LEDS(n)		(((n) & 1) + (((n) >> 1) & 1) + (((n) >> 2) & 1) + (((n) >> 3) & 1) +	\
+						(((n) >> 4) & 1) + (((n) >> 5) & 1) + (((n) >> 6) & 1) + (((n) >> 7) & 1))
+	#define LEDS4(n)	LEDS(n), LEDS(n + 1), LEDS(n + 2), LEDS(n + 3)
+	#define LEDS16(n)	LEDS4(n), LEDS4(n + 4), LEDS4(n + 8), LEDS4(n + 12)
+	const uint8_t led_count[] PROGMEM = {
+		LEDS16(0),  LEDS16(16), LEDS16(32), LEDS16(48), LEDS16(64), LEDS16(80), LEDS16(96), LEDS16(112)
+		#if DISP_ROWS > 7
+		, LEDS16(128), LEDS16(144), LEDS16(160), LEDS16(176), LEDS16(192), LEDS16(208), LEDS16(224), LEDS16(240)
+		#endif
+	};
+#endif
+
+#ifdef DISP_COMPENSATION
+	// number of leds of a scanned line (a row with row scanning, a column otherwise)
+	#ifdef DISP_ROW_SCAN
+		#define LINE_LEDS	DISP_COLUMNS
+	#else
+		#define LINE_LEDS	DISP_ROWS
+	#endif
+	// relative on-time for lines with 0..LINE_LEDS lit leds (16 = 100 %)
+	#define COMP(k, x)	(8 + (8 * (k) + LINE_LEDS / 2) / LINE_LEDS)
+	const uint8_t comp_conv[LINE_LEDS + 1] PROGMEM = { COMP(0, 0), LIST(LINE_LEDS, COMP, 0) };
+#endif
+
+#ifdef DISP_ENERGY_CAP
+	// maximum on-time for a frame following a frame with n lit leds (0 = no limit)
+	#define CAP(n)		((n) <= DISP_ENERGY_BUDGET ? 0 : (256 * DISP_ENERGY_BUDGET) / (n))
+	#define CAP4(n)		CAP(n), CAP(n + 1), CAP(n + 2), CAP(n + 3)
+	const uint8_t cap_conv[] PROGMEM = {
+		CAP4(0), CAP4(4), CAP4(8), CAP4(12), CAP4(16), CAP4(20), CAP4(24), CAP4(28), CAP4(32)
+		#if DISP_COLUMNS * DISP_ROWS > 35
+		, CAP4(36), CAP4(40), CAP4(44), CAP4(48), CAP4(52), CAP4(56), CAP4(60), CAP4(64)
+		#endif
+	};
+#endif
+
+#ifdef DISP_SOURCES
+	// source types
+	#define SRC_RAM			0				// display memory
+	#define SRC_FLASH		1
+	#define SRC_EEPROM		2
+
+	typedef struct {
+		uint8_t type;					// source type (see above)
+		disp_pos_t len;					// number of columns
+		const uint8_t* adr;				// address of first column
+	} source_t;
+#endif
+
+#ifdef DISP_ATTRIBUTES
+	typedef struct {
+		disp_pos_t first;				// index of first column
+		disp_pos_t last;				// index of last column (ATTR_OPEN = up to the end)
+		uint8_t attr;					// attributes (see ATTR_INVERT etc.)
+		uint8_t blink;					// bit of the frame counter that hides the region (0 = no blinking)
+	} attr_t;
+	#define ATTR_OPEN		((disp_pos_t) ~0)	// last column of a region that has not been ended
+#endif
+
+#ifdef DISP_ROW_SCAN
+	#define DISP_LINES		DISP_ROWS
 #else
-	const uint8_t col_port[] PROGMEM = {C1_PORT, C2_PORT, C3_PORT, C4_PORT, C5_PORT};
-	const uint8_t col_bit[]  PROGMEM = {(1<<C1), (1<<C2), (1<<C3), (1<<C4), (1<<C5)};
-	const uint8_t row_port[] PROGMEM = {R1_PORT, R2_PORT, R3_PORT, R4_PORT, R5_PORT, R6_PORT, R7_PORT};
-	const uint8_t row_bit[]  PROGMEM = {(1<<R1), (1<<R2), (1<<R3), (1<<R4), (1<<R5), (1<<R6), (1<<R7)};
+	#define DISP_LINES		DISP_COLUMNS
+#endif
+#if defined(DISP_ROW_SCAN) || defined(DISP_INTERLACE)
+	#define DISP_FRAME
+#endif
+#ifdef DISP_SHIFT_OUT
+	#define SR_BYTES		((DISP_WIDTH - DISP_COLUMNS + 7) / 8)	// number of shift registers
+#endif
+
+#ifdef DISP_INTERLACE
+	// scan sequence of the rows or columns (see dot_matrix.h)
+	#define EVEN_FIRST(k, n)	((k) <= ((n) + 1) / 2 ? 2 * (k) - 2 : 2 * ((k) - ((n) + 1) / 2) - 1)
+	#ifndef DISP_COLUMN_ORDER
+		#define DISP_COLUMN_ORDER	{ LIST(DISP_COLUMNS, EVEN_FIRST, DISP_COLUMNS) }
+	#endif
+	#ifndef DISP_ROW_ORDER
+		#define DISP_ROW_ORDER		{ LIST(DISP_ROWS, EVEN_FIRST, DISP_ROWS) }
+	#endif
+	#ifdef DISP_ROW_SCAN
+	const uint8_t scan_order[DISP_LINES] PROGMEM = DISP_ROW_ORDER;
+	#else
+	const uint8_t scan_order[DISP_LINES] PROGMEM = DISP_COLUMN_ORDER;
+	#endif
 #endif
 
 // The display memory contains all the data to be displayed. Of the display memory
 // only a small window, whose size matches the dot matrix display, is actually displayed.
 typedef struct {
 	uint8_t memory[DISP_MAX];	// display memory (every byte encodes a column)
-	uint8_t base;				// index of column 1 of currently displayed window
+#ifdef DISP_GRAYSCALE
+	uint8_t shade[DISP_MAX];	// second plane for grayscale mode (see dot_matrix.h)
+	uint8_t phase;				// 0 = long phase, 1 = short phase of current column
+#endif
+#ifndef DISP_FAST_ISR
+	disp_pos_t base;			// index of column 1 of currently displayed window
 	uint8_t curr_col;			// index of currently displayed column within window
+#endif
+#ifdef DISP_FRAME
+	uint8_t curr_line;			// index of current step of the scan sequence
+	uint8_t frame[DISP_LINES];	// rows (row scanning) or columns of the window read at the start of a frame
+#ifdef DISP_SHIFT_OUT
+	uint8_t ext[DISP_ROWS][SR_BYTES];	// rows of the module columns (bit 0 of byte 0 = column DISP_COLUMNS + 1)
+	uint16_t shift_cycles;		// peak duration of a shift-out [cycles of timer 1]
+#endif
+#endif
 	uint8_t scroll_mode;		// lower nibble = increment of display base for each scrolling step (0 = off)
 	// bit 4 = direction (0 = forward, 1 = backward)
 	// bit 5 = bidirectional (0 = off, 1 = on)
-	uint8_t cursor;				// index of first free byte after current display content (0 = empty display)
+	disp_pos_t cursor;			// index of first free byte after current display content (0 = empty display)
+#ifdef DISP_PAD
+	uint8_t pad;				// number of blank columns before and after the content
+#endif
 	uint8_t scroll_delay;		// delay (number of scrolling steps) before scrolling cycle restarts
 	uint8_t delay_counter;		// counter for scroll delays (counting down to zero)
+#ifdef DISP_TEXT_MODE
+	disp_pos_t base_char;		// text mode: character and column within character of column 1 of window
+	uint8_t base_offset;
+	uint16_t base_col;			// text mode: index of column 1 of window
+	uint16_t text_cols;			// text mode: number of columns of all characters including spacing
+	disp_pos_t scan_char;		// text mode: character and column within character of current column
+	uint8_t scan_offset;
+#endif
+#ifdef DISP_SOURCES
+	source_t source[DISP_SOURCE_COUNT];	// source descriptors (cursor = sum of their lengths)
+	uint8_t sources;			// number of used source descriptors
+	disp_pos_t ram;				// index of first free byte of display memory
+	uint8_t scan_src;			// source and column within source of current column
+	disp_pos_t scan_pos;
+#endif
+#ifdef DISP_RING
+	uint16_t ring_base;			// ring buffer: position of column 1 of window
+	uint16_t head;				// ring buffer: position of first free column (see dot_matrix.h)
+	uint8_t ring_state;			// ring buffer: see RING_STATIC etc.
+#endif
+#ifdef DISP_ATTRIBUTES
+	attr_t attr[DISP_ATTR_COUNT];	// attribute regions
+	uint8_t attrs;				// number of used attribute regions
+	uint8_t frames;				// frame counter for blinking (wrapping around)
+#endif
+#ifdef DISP_VSCROLL
+	int8_t v_shift;				// vertical scrolling: number of rows the content is moved up (< 0 = down)
+	uint8_t v_dir;				// vertical scrolling: direction (see VSCROLL_OFF etc.)
+	uint8_t v_delay;			// vertical scrolling: delay (number of scrolling steps) at original position
+	uint8_t v_counter;			// vertical scrolling: counter for delays (counting down to zero)
+#endif
+#ifdef DISP_LAYERS
+	const uint8_t* bg_image;	// background layer: image in flash
+	uint8_t bg_len;				// background layer: number of columns (0 = no background)
+	uint8_t bg_base;			// background layer: index of column 1 of window
+	uint8_t bg_inc;				// background layer: increment for each scrolling step
+	uint8_t layer_op;			// combination of the layers (see LAYER_OR etc.)
+#endif
+#ifdef DISP_RUNTIME_MATRIX
+	uint8_t matrix;				// matrix type and polarity (see MATRIX_HDSP5403 and MATRIX_ANODE)
+#endif
+#ifdef DISP_PREFETCH
+	disp_pos_t start;			// index of first column of displayed content
+	disp_pos_t end;				// index of first column after displayed content
+	disp_pos_t limit;			// end of free display memory at cursor
+	disp_pos_t next_start;		// displayed content after dmFlip (see dmEndPrefetch)
+	disp_pos_t next_end;
+#endif
+#ifdef DISP_COMPENSATION
+	uint8_t on_time[LINE_LEDS + 1];	// on-time for lines with 0..LINE_LEDS lit leds (see dmSetBrightness)
+#elif defined(DISP_BRIGHTNESS)
+	uint8_t on_time;			// on-time of each column in units of 16 cycles (0 = always on)
+#endif
+#ifdef DISP_ENERGY_CAP
+	uint8_t frame_leds;			// number of lit leds of the current frame
+	uint8_t cap;				// maximum on-time for the current frame (0 = no limit)
+	uint32_t energy;			// sum of lit leds times on-time (see dot_matrix.h)
+#endif
 } display_t;
 
 display_t display;
 
+// With the hand-tuned display interrupt the window base and the current column
+// are kept in general purpose I/O registers, which can be accessed in a single cycle.
+#ifdef DISP_FAST_ISR
+	#define DISP_CURR_COL	GPIOR1
+	#define DISP_BASE		GPIOR2
+#else
+	#define DISP_CURR_COL	display.curr_col
+	#define DISP_BASE		display.base
+#endif
+
+// The display interrupt scans either the columns or the rows of the led matrix.
+// With row scanning or interlaced scanning the window is read at the start of a frame.
+#if defined(DISP_FRAME)
+	#define DISP_SCAN		display.curr_line
+#else
+	#define DISP_SCAN		DISP_CURR_COL
+#endif
+
+// With prefetching the displayed content starts at display.start and ends at display.end.
+// Otherwise it starts at 0 and ends at the cursor.
+#ifdef DISP_PREFETCH
+	#define DISP_START		display.start
+	#define DISP_END		display.end
+	#define DISP_LIMIT		display.limit
+#else
+	#define DISP_START		0
+	#define DISP_END		display.cursor
+	#define DISP_LIMIT		DISP_MAX
+#endif
+
+// With padding the scrolling range includes display.pad blank columns on either side.
+#ifdef DISP_PAD
+	#define DISP_PADDING	display.pad
+#else
+	#define DISP_PADDING	0
+#endif
+#define DISP_RANGE			(disp_pos_t)(DISP_END - DISP_START + 2 * DISP_PADDING)
+
 /**********
  * makros *
  **********/
 
-#define BIT_IS_ON	(pattern & 1)
-#define NEXT_BIT	pattern >>= 1
-#define COL			col
+// read a byte from the output tables
+#ifdef DISP_RUNTIME_MATRIX
+	#define READ_TABLE(adr)			(*(adr))
+#else
+	#define READ_TABLE(adr)			pgm_read_byte(adr)
+#endif
+
+// write a position that the display interrupt reads (16 bit positions must not be torn)
+#if DISP_MAX > 255
+	#define SET_POS(var, pos)		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { (var) = (pos); }
+#else
+	#define SET_POS(var, pos)		(var) = (pos)
+#endif
+
+// move the cursor (the displayed content grows with it unless a prefetch is running)
+// With source descriptors the cursor of the display memory is display.ram.
+#ifdef DISP_SOURCES
+	#define RAM_CURSOR				display.ram
+	#define SET_CURSOR(pos)			dmSetRamCursor(pos)
+#elif defined(DISP_PREFETCH)
+	#define SET_CURSOR(pos)			{ display.cursor = (pos);  if ((DISP_FLAGS & (1<<DISP_DEFER)) == 0) { SET_POS(display.end, display.cursor); } }
+#else
+	#define SET_CURSOR(pos)			SET_POS(display.cursor, pos)
+#endif
+#ifndef RAM_CURSOR
+	#define RAM_CURSOR				display.cursor
+#endif
+
+// write a column of full brightness to the display memory
+#ifdef DISP_GRAYSCALE
+	#define PUT_COLUMN(pos, byt)	{ display.memory[pos] = (byt);  display.shade[pos] = 0; }
+#else
+	#define PUT_COLUMN(pos, byt)	display.memory[pos] = (byt)
+#endif
 
 // Usage: swap(b)
 #define swap(x) 											\
@@ -95,223 +491,1678 @@ void dmInit(void)
 	dmClearDisplay();
 	display.scroll_mode = 0;
 	display.scroll_delay = 0;
+	#ifdef DISP_PAD
+	display.pad = 0;
+	#endif
+}
+
+
+#ifdef DISP_SHIFT_OUT
+/*======================================================================
+	Function:		dmShiftOut
+	Input:			row number
+	Output:			none
+	Description:	Shift the row pattern of the module columns into the shift
+					register chain without changing its outputs (see dmSetOutputs).
+					The last column is shifted first. Every bit takes 4 port
+					instructions (sbi/cbi), i. e. 8 to 9 cycles.
+======================================================================*/
+// shift out bit n of b
+#define SHIFT_BIT(b, n)	SR_DATA_PORT &= ~(1<<SR_DATA);								\
+						if ((b) & (1 << (n))) { SR_DATA_PORT |= (1<<SR_DATA); }	\
+						SR_CLOCK_PORT |= (1<<SR_CLOCK);							\
+						SR_CLOCK_PORT &= ~(1<<SR_CLOCK)
+
+inline void dmShiftOut(uint8_t row)
+{
+	uint8_t i, b;
+	uint16_t t;
+
+	t = TCNT1;
+	for (i = SR_BYTES; i; i--) {
+		b = 0;
+		if (!(DISP_FLAGS & (1<<DISP_BLANK))) { b = display.ext[row][i - 1]; }
+		#if DISP_TYPE == 0
+		b = ~b;								// common column cathode: lit columns are low
+		#endif
+		SHIFT_BIT(b, 7);
+		SHIFT_BIT(b, 6);
+		SHIFT_BIT(b, 5);
+		SHIFT_BIT(b, 4);
+		SHIFT_BIT(b, 3);
+		SHIFT_BIT(b, 2);
+		SHIFT_BIT(b, 1);
+		SHIFT_BIT(b, 0);
+	}
+	t = TCNT1 - t;
+	if (t > display.shift_cycles) { display.shift_cycles = t; }
 }
+#endif
 
 
 /*======================================================================
 	Function:		dmSetOutputs
-	Input:			column number
+	Input:			column number (row number with row scanning)
 					bit pattern
 	Output:			none
 	Description:	Set row and column outputs so that the leds of the specified 
 					column represent the bit pattern (1 = led on).
+					With row scanning the leds of the specified row represent
+					the bit pattern (bit 0 = column 1).
+					With DISP_ANTI_GHOST the ports B and D are switched off
+					before the new values are written (see dot_matrix.h).
 ======================================================================*/
-inline void dmSetOutputs(uint8_t col, uint8_t pattern)
+#ifdef DISP_ROW_SCAN
+inline void dmSetOutputs(uint8_t row, uint8_t pattern)
 {
 	uint8_t i;
-	uint8_t p[3];
+	const uint8_t* rs;
+	const uint8_t* cl;
 
-	p[0] = 0;  p[1] = 0;  p[2] = 0;
-	for (i = 0; i < DISP_ROWS; i++) {
-		if (BIT_IS_ON) {
-			p[ pgm_read_byte(&row_port[i]) ] |= pgm_read_byte(&row_bit[i]);		// set bit
-		}
-		NEXT_BIT;
-	}		
-	for (i = 0; i < DISP_COLUMNS; i++) {
-		if (i != COL) {					// note: COL is a macro
-			p[ pgm_read_byte(&col_port[i]) ] |= pgm_read_byte(&col_bit[i]);		// set bit
-		}
+#ifdef DISP_ORIENTATION_TABLES
+	rs = row_sel[(DISP_FLAGS >> DISP_FLIP) & 1][row];		// current row only
+	cl = col_lit[(DISP_FLAGS >> DISP_MIRROR) & 1][pattern & ALL_COLS];	// lit columns
+#else
+	rs = row_sel[row];					// current row only
+	cl = col_lit[pattern & ALL_COLS];	// lit columns
+#endif
+	#ifdef DISP_SHIFT_OUT
+	// The modules share the rows, so dmBlank (no row selected) needs no shift-out.
+	if (row < DISP_ROWS) { dmShiftOut(row); }	// module columns, shown when latched
+	#endif
+
+	// set outputs
+	#ifdef DISP_ANTI_GHOST
+	i = PORTB & ~DISP_MASK_B;			// switch off the ports with column pins first
+	PORTB = i | READ_TABLE(&all_off[B]);
+	i = PORTD & ~DISP_MASK_D;
+	PORTD = i | READ_TABLE(&all_off[D]);
+	#endif
+	#ifdef DISP_SHIFT_OUT
+	if (row < DISP_ROWS) {
+		#ifdef DISP_ANTI_GHOST
+		i = PORTA & ~DISP_MASK_A;		// the rows on port A must be off while the modules change
+		PORTA = i | READ_TABLE(&all_off[A]);
+		#endif
+		SR_LATCH_PORT |= (1<<SR_LATCH);	// latch module columns
+		SR_LATCH_PORT &= ~(1<<SR_LATCH);
 	}
-	#if DISP_TYPE == 1					// if we use a display with common column anode
-		p[0] ^= DISP_MASK_A;				// -> invert outputs
-		p[1] ^= DISP_MASK_B;
-		p[2] ^= DISP_MASK_D;
 	#endif
+	i = PORTA & ~DISP_MASK_A;
+	PORTA = i | pgm_read_byte(&rs[A]) | pgm_read_byte(&cl[A]);
+	i = PORTB & ~DISP_MASK_B;
+	PORTB = i | pgm_read_byte(&rs[B]) | pgm_read_byte(&cl[B]);
+	i = PORTD & ~DISP_MASK_D;
+	PORTD = i | pgm_read_byte(&rs[D]) | pgm_read_byte(&cl[D]);
+}
+#else
+inline void dmSetOutputs(uint8_t col, uint8_t pattern)
+{
+	uint8_t i;
+	const uint8_t* lo;
+	const uint8_t* hi;
+	const uint8_t* co;
+
+#ifdef DISP_ORIENTATION_TABLES
+	uint8_t flip, mirror;
+
+	flip = (DISP_FLAGS >> DISP_FLIP) & 1;
+	mirror = (DISP_FLAGS >> DISP_MIRROR) & 1;
+	lo = row_lo[flip][pattern & 0x0F];	// rows 1..4
+	swap(pattern);
+	hi = row_hi[flip][pattern & (ROW_HI_COUNT - 1)];	// rows 5..8
+	co = col_out[mirror][col];			// all columns except the current one
+#else
+	lo = row_lo[pattern & 0x0F];		// rows 1..4
+	swap(pattern);
+	hi = row_hi[pattern & (ROW_HI_COUNT - 1)];	// rows 5..8
+	co = col_out[col];					// all columns except the current one
+#endif
 
 	// set outputs
+	#ifdef DISP_ANTI_GHOST
+	i = PORTB & ~DISP_MASK_B;			// switch off the ports with column pins first
+	PORTB = i | READ_TABLE(&all_off[B]);
+	i = PORTD & ~DISP_MASK_D;
+	PORTD = i | READ_TABLE(&all_off[D]);
+	#endif
 	i = PORTA & ~DISP_MASK_A;
-	PORTA = i | p[0];
+	PORTA = i | READ_TABLE(&lo[A]) | READ_TABLE(&hi[A]) | READ_TABLE(&co[A]);
 	i = PORTB & ~DISP_MASK_B;
-	PORTB = i | p[1];
+	PORTB = i | READ_TABLE(&lo[B]) | READ_TABLE(&hi[B]) | READ_TABLE(&co[B]);
 	i = PORTD & ~DISP_MASK_D;
-	PORTD = i | p[2];
+	PORTD = i | READ_TABLE(&lo[D]) | READ_TABLE(&hi[D]) | READ_TABLE(&co[D]);
+}
+#endif
+
+
+#ifdef DISP_TEXT_MODE
+/*======================================================================
+	Function:		dmGlyph
+	Input:			index of character in display memory
+					column within character
+	Output:			column pattern (0x80 = spacing column after the character)
+	Description:	Read a column of a character from the font (text mode).
+======================================================================*/
+static uint8_t dmGlyph(disp_pos_t c, uint8_t offset)
+{
+	uint16_t fnt;
+
+	if (offset >= CHAR_WIDTH) { return (0x80); }
+	fnt = display.memory[c];
+	fnt = (fnt << 2) + fnt + offset;		// fnt = 5 * index + offset
+	return (pgm_read_byte(&font[fnt]));
 }
 
 
 /*======================================================================
-	Function:		dmDisplay
+	Function:		dmGlyphWidth
+	Input:			index of character in display memory
+	Output:			number of columns of the character without spacing
+	Description:	Get the width of a character (text mode).
+======================================================================*/
+static uint8_t dmGlyphWidth(disp_pos_t c)
+{
+	uint8_t offset = 0;
+
+	while ((dmGlyph(c, offset) & 0x80) == 0) { offset++; }
+	return (offset);
+}
+
+
+/*======================================================================
+	Function:		dmTextColumn
 	Input:			none
-	Output:			none
-	Description:	Switch to the next display column and display it on the led matrix.
-					Call this function periodically, e. g. within an interrupt routine.
+	Output:			column pattern
+	Description:	Get the pattern of the current column of the window and
+					advance to the next column (text mode).
+					The window position is taken over at the start of a frame.
 ======================================================================*/
-void dmDisplay(void)
+static uint8_t dmTextColumn(void)
 {
-	display.curr_col++;
-	if (display.curr_col >= DISP_COLUMNS) {
-		display.curr_col = 0;
+	uint8_t pattern = 0;
+
+	if (DISP_CURR_COL == 0) {
+		display.scan_char = display.base_char;
+		display.scan_offset = display.base_offset;
 	}
-	dmSetOutputs(display.curr_col, display.memory[display.base + display.curr_col]);
+	if (display.scan_char < display.cursor) {
+		pattern = dmGlyph(display.scan_char, display.scan_offset);
+		if (pattern & 0x80)	{ pattern = 0;  display.scan_char++;  display.scan_offset = 0; }
+		else				{ display.scan_offset++; }
+	}
+	return (pattern);
 }
+#endif
 
 
+#ifdef DISP_SOURCES
 /*======================================================================
-	Function:		dmScroll
+	Function:		dmSourceColumn
 	Input:			none
-	Output:			status
-	Description:	Scroll display by one step. Returns 1 if end of scrolling range has been reached.
-					Call this function periodically, e. g. within an interrupt routine.
+	Output:			column pattern
+	Description:	Get the pattern of the current column of the window from its
+					source and advance to the next column.
+					Reading the EEPROM saves and restores the address and data
+					registers in case the main program is accessing the EEPROM.
 ======================================================================*/
-uint8_t dmScroll(void)
+static uint8_t dmSourceColumn(void)
 {
-	uint8_t temp, mode;
-
-	mode = display.scroll_mode;
-	temp = mode & 0x0F;										// extract increment
-	if (mode & 0x10)	{ temp = display.base - temp; }		// scrolling backward
-															// We use a dirty trick here:
-															// Temp may underflow at left end of display memory.
-	else				{ temp = display.base + temp; }		// scrolling forward
+	uint8_t i, dat, pattern = 0;
+	uint16_t adr;
+	disp_pos_t pos;
+	const source_t* src;
 
-	if ((temp + DISP_COLUMNS) > display.cursor ) {			// end of scrolling range reached?
-															// Note: As temp is allowed to underflow, this is 
-															// true at both ends of the display memory.
-		if (display.delay_counter) {
-			display.delay_counter--;
-		}
-		else {
-			display.delay_counter = display.scroll_delay;					// reload delay counter
-			if (mode & 0x20)		{ display.scroll_mode = mode ^ 0x10; }	// reverse direction
-			else if (mode &0x10)	{ display.base = display.cursor - DISP_COLUMNS; }	// restart from right end
-			else					{ display.base = 0; }					// restart from left end
+	if (DISP_CURR_COL == 0) {							// find source of column 1 of window
+		pos = DISP_BASE;
+		i = 0;
+		while ((i < display.sources) && (pos >= display.source[i].len)) {
+			pos -= display.source[i].len;
+			i++;
 		}
-		return (1);
+		display.scan_src = i;
+		display.scan_pos = pos;
 	}
-	else {
-		display.base = temp;
-		return (0);
+	if (display.scan_src < display.sources) {
+		src = &display.source[display.scan_src];
+		switch (src->type) {
+			case SRC_RAM:
+				pattern = src->adr[display.scan_pos];
+				break;
+			case SRC_FLASH:
+				pattern = pgm_read_byte(src->adr + display.scan_pos);
+				break;
+			case SRC_EEPROM:
+				if ((EECR & (1<<EEPE)) == 0) {			// no write in progress?
+					adr = EEAR;
+					dat = EEDR;
+					EEAR = (uint16_t) src->adr + display.scan_pos;
+					EECR |= (1<<EERE);
+					pattern = EEDR;
+					EEDR = dat;
+					EEAR = adr;
+				}
+				break;
+		}
+		display.scan_pos++;
+		if (display.scan_pos >= src->len) {
+			display.scan_src++;
+			display.scan_pos = 0;
+		}
 	}
+	return (pattern);
 }
+#endif
 
 
+#ifndef DISP_FAST_ISR
 /*======================================================================
-	Function:		dmSetScrolling
-	Input:			increment (range 0..15)
-					direction (0 = forward, 1 = backward, 2 = bidirectional)
-					delay     (range 0..255)
-	Output:			none
-	Description:	Set scrolling increment and direction.
-					Delay sets number of scrolling steps to wait at end of scrolling range.
+	Function:		dmForeground
+	Input:			none
+	Output:			column pattern
+	Description:	Get the pattern of the current column of the window from the
+					display content.
 ======================================================================*/
-void dmSetScrolling(uint8_t inc, uint8_t dir, uint8_t delay)
+static inline uint8_t dmForeground(void)
 {
-	inc &= 0x0F;		// limit range
-	dir &= 0x03;		// limit range
-	if (dir != BACKWARD)	{ display.delay_counter = delay; }
-	else					{ display.delay_counter = 0; }
-	swap(dir);
-	display.scroll_mode   = inc | dir;
-	display.scroll_delay  = delay;
+#ifdef DISP_RING
+	uint16_t pos;
+#endif
+#ifdef DISP_PAD
+	disp_pos_t col;
+#endif
+
+	#ifdef DISP_TEXT_MODE
+	if (DISP_FLAGS & (1<<DISP_TEXT))	{ return (dmTextColumn()); }
+	#endif
+	#ifdef DISP_SOURCES
+	return (dmSourceColumn());
+	#elif defined(DISP_RING)
+	pos = display.ring_base + DISP_CURR_COL;
+	if (pos < display.head)	{ return (display.memory[(uint8_t)pos & (DISP_MAX - 1)]); }
+	else					{ return (0); }
+	#elif defined(DISP_PAD)
+	col = DISP_BASE - DISP_START + DISP_CURR_COL - DISP_PADDING;	// underflows within the leading blank columns
+	if (col < (disp_pos_t)(DISP_END - DISP_START))	{ return (display.memory[DISP_START + col]); }
+	else										{ return (0); }
+	#else
+	return (display.memory[DISP_BASE + DISP_CURR_COL]);
+	#endif
 }
 
 
 /*======================================================================
-	Function:		dmClearDisplay
+	Function:		dmReadColumn
 	Input:			none
-	Output:			none
-	Description:	Set display cursor to begin of display memory and 
-					clear visible part of display memory.
+	Output:			column pattern
+	Description:	Get the pattern of the current column of the window as it
+					is shown, i. e. with attributes applied, shifted vertically
+					and combined with the background layer.
 ======================================================================*/
-void dmClearDisplay(void)
+static inline uint8_t dmReadColumn(void)
 {
+	uint8_t pattern;
+#ifdef DISP_ATTRIBUTES
+	attr_t* region;
 	uint8_t i;
+	disp_pos_t col;
+#endif
+#ifdef DISP_LAYERS
+	uint8_t bg;
+	uint16_t pos;
+#endif
 
-	display.base  = 0;
-	display.cursor = 0;
-	for (i = 0; i < DISP_COLUMNS; i++) {
-		display.memory[i] = 0;
+	pattern = dmForeground();
+	#ifdef DISP_ATTRIBUTES
+	col = DISP_BASE + DISP_CURR_COL - DISP_PADDING;
+	i = display.attrs;
+	if (col >= DISP_END) { i = 0; }						// no attributes outside of the content
+	region = display.attr;
+	for (; i; i--) {
+		if ((col >= region->first) && (col <= region->last)) {
+			if (region->attr & ATTR_INVERT) { pattern ^= ALL_ROWS; }
+			if ((region->attr & ATTR_HIDE) || (region->blink & display.frames)) { pattern = 0; }
+		}
+		region++;
+	}
+	#endif
+	#ifdef DISP_VSCROLL
+	if (display.v_shift > 0)		{ pattern = (pattern & ALL_ROWS) >> display.v_shift; }
+	else if (display.v_shift < 0)	{ pattern = (pattern << -display.v_shift) & ALL_ROWS; }
+	#endif
+	#ifdef DISP_LAYERS
+	if (display.bg_len) {
+		pos = display.bg_base + DISP_CURR_COL;
+		while (pos >= display.bg_len) { pos -= display.bg_len; }	// background is repeated
+		bg = pgm_read_byte(display.bg_image + pos);
+		if (display.layer_op == LAYER_XOR)			{ pattern ^= bg; }
+		else if (display.layer_op == LAYER_MASK)	{ pattern = bg & ~pattern; }
+		else										{ pattern |= bg; }
 	}
+	#endif
+	return (pattern);
 }
 
 
+#ifdef DISP_SHIFT_OUT
 /*======================================================================
-	Function:		dmDisplayImage
-	Input:			pointer to graphics data in flash memory
+	Function:		dmReadModules
+	Input:			none
 	Output:			none
-	Description:	Copy flash contents to display memory at current cursor position 
-					until the end-of-data marker (0xFF) is reached.
+	Description:	Read the columns of the window that are shown on the modules
+					and transpose them into the rows that are shifted out.
 ======================================================================*/
-void dmDisplayImage(const uint8_t* image)
+static void dmReadModules(void)
 {
-	uint8_t img_data, pos;
+	uint8_t r, i, pattern, bit;
 
-	pos = display.cursor;
-	while(pos < DISP_MAX) {
-		img_data = pgm_read_byte(image++);	// read byte from flash
-		if (img_data == 0xFF) { break; }	// stop if end-of-data has been reached
-		display.memory[pos] = img_data;
-		pos++;
+	for (r = 0; r < DISP_ROWS; r++) {
+		for (i = 0; i < SR_BYTES; i++) { display.ext[r][i] = 0; }
+	}
+	i = 0;
+	bit = 1;
+	for (DISP_CURR_COL = DISP_COLUMNS; DISP_CURR_COL < DISP_WIDTH; DISP_CURR_COL++) {
+		pattern = dmReadColumn();
+		for (r = 0; r < DISP_ROWS; r++) {
+			if (pattern & 1) { display.ext[r][i] |= bit; }
+			pattern >>= 1;
+		}
+		bit <<= 1;
+		if (bit == 0) { bit = 1;  i++; }				// next shift register
 	}
-	display.cursor = pos;
 }
 
 
 /*======================================================================
-	Function:		dmPrintByte
-	Input:			byte
-	Output:			none
-	Description:	Write byte directly to the display memory.
+	Function:		dmReadShiftCycles
+	Input:			clear flag (1 = reset peak value after reading)
+	Output:			peak duration of a shift-out [cycles] (0 if timer 1 is stopped)
+	Description:	Read the peak duration of shifting out one row to the modules.
+					Divided by DISP_WIDTH - DISP_COLUMNS it gives the cost per column.
 ======================================================================*/
-void dmPrintByte(uint8_t byt)
+uint16_t dmReadShiftCycles(uint8_t clear)
 {
-	uint8_t pos;
+	uint16_t cycles;
 
-	pos = display.cursor;
-	if (pos < DISP_MAX) { 
-		display.memory[pos] = byt;
-		pos++;
-		display.cursor = pos;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		cycles = display.shift_cycles;
+		if (clear) { display.shift_cycles = 0; }
 	}
+	return (cycles);
 }
+#endif
 
 
+#ifdef DISP_FRAME
 /*======================================================================
-	Function:		dmPrintChar
-	Input:			character code
+	Function:		dmReadFrame
+	Input:			none
 	Output:			none
-	Description:	Print character to display memory at current display cursor.
+	Description:	Read all columns of the window for the next frame. With row
+					scanning they are transposed into row patterns.
 ======================================================================*/
-void dmPrintChar(uint8_t ch)
+static void dmReadFrame(void)
 {
-	uint8_t  i, pos, char_data;
-	uint16_t fnt;			// pointer into character font
+#ifdef DISP_ROW_SCAN
+	uint8_t r, pattern, bit;
 
-	// mapping of german special characters
-	if (ch == 223) { ch = 138; }		// ''
-	if (ch == 196) { ch = 133; }		// ''
-	if (ch == 214) { ch = 135; }		// ''
-	if (ch == 220) { ch = 137; }		// ''
-	if (ch == 228) { ch = 132; }		// ''
-	if (ch == 246) { ch = 134; }		// ''
-	if (ch == 252) { ch = 136; }		// ''
-	ch -= 32;
-	if (ch > (sizeof(font)/CHAR_WIDTH)) { return; }
-		
-	fnt = ch;
-	fnt = (fnt << 2) + fnt + (uint16_t) &font[0];		// fnt = &font + 5 * ch
-	
-	pos = display.cursor;
-	for (i = 0; i < CHAR_WIDTH; i++) {
-		char_data = pgm_read_byte(fnt++);	// read byte from font
-		if (char_data & 0x80) { break; }	// stop if MSB is set (proportional character width)
-		if (pos < DISP_MAX) {
-			display.memory[pos] = char_data;
-			pos++;
-		}		
+	for (r = 0; r < DISP_ROWS; r++) { display.frame[r] = 0; }
+	bit = 1;
+	for (DISP_CURR_COL = 0; DISP_CURR_COL < DISP_COLUMNS; DISP_CURR_COL++) {
+		pattern = dmReadColumn();
+		for (r = 0; r < DISP_ROWS; r++) {
+			if (pattern & 1) { display.frame[r] |= bit; }
+			pattern >>= 1;
+		}
+		bit <<= 1;
 	}
-	display.cursor = pos;
+	#ifdef DISP_SHIFT_OUT
+	dmReadModules();
+	#endif
+#else
+	for (DISP_CURR_COL = 0; DISP_CURR_COL < DISP_COLUMNS; DISP_CURR_COL++) {
+		display.frame[DISP_CURR_COL] = dmReadColumn();
+	}
+#endif
 }
+#endif
+
+
+/*======================================================================
+	Function:		dmDisplay
+	Input:			none
+	Output:			phase (1 = short grayscale phase has been started, 0 otherwise)
+	Description:	Switch to the next display column and display it on the led matrix
+					(the next row with row scanning, in the order of the scan
+					sequence with interlaced scanning).
+					Call this function periodically, e. g. within an interrupt routine.
+					In grayscale mode every column is displayed in two phases. The
+					caller has to adjust the time until the next call to the phase.
+======================================================================*/
+uint8_t dmDisplay(void)
+{
+	uint8_t pattern, line;
+#ifdef DISP_BRIGHTNESS
+	uint8_t on_time;
+#endif
+#if defined(DISP_COMPENSATION) || defined(DISP_ENERGY_CAP)
+	uint8_t leds;
+#endif
+#ifdef DISP_ENERGY_CAP
+	uint16_t t, e;
+#endif
+#ifdef DISP_GRAYSCALE
+	disp_pos_t pos;
+
+	if (display.phase == 0) {				// switch to short phase of current column
+		display.phase = 1;
+		pos = DISP_BASE + DISP_CURR_COL;
+		pattern = display.memory[pos] ^ display.shade[pos];
+		if (DISP_FLAGS & (1<<DISP_BLANK)) { pattern = 0; }
+		dmSetOutputs(DISP_CURR_COL, pattern);
+		return (1);
+	}
+	display.phase = 0;
+#endif
+	DISP_SCAN++;
+	if (DISP_SCAN >= DISP_LINES) {
+		DISP_SCAN = 0;
+		// a hold request takes effect at the start of a frame
+		if (DISP_FLAGS & (1<<DISP_HOLD))	{ DISP_FLAGS |= (1<<DISP_BLANK); }
+		else								{ DISP_FLAGS &= ~(1<<DISP_BLANK); }
+		#ifdef DISP_ENERGY_CAP
+		display.cap = pgm_read_byte(&cap_conv[display.frame_leds]);
+		display.frame_leds = 0;
+		#endif
+		#ifdef DISP_ATTRIBUTES
+		display.frames++;
+		#endif
+		#ifdef DISP_FRAME
+		dmReadFrame();
+		#endif
+	}
+	#ifdef DISP_INTERLACE
+	line = pgm_read_byte(&scan_order[DISP_SCAN]);
+	#else
+	line = DISP_SCAN;
+	#endif
+	#ifdef DISP_FRAME
+	pattern = display.frame[line];
+	#else
+	pattern = dmReadColumn();
+	#endif
+	if (DISP_FLAGS & (1<<DISP_BLANK)) { pattern = 0; }
+	dmSetOutputs(line, pattern);
+	if (DISP_SCAN == DISP_LINES - 1) { DISP_FLAGS |= (1<<DISP_SYNC); }	// frame completed
+#ifdef DISP_BRIGHTNESS
+	#if defined(DISP_COMPENSATION) || defined(DISP_ENERGY_CAP)
+	leds = pgm_read_byte(&led_count[pattern & ALL_ROWS]);
+	#endif
+	#ifdef DISP_COMPENSATION
+	on_time = display.on_time[leds];
+	#else
+	on_time = display.on_time;
+	#endif
+	#ifdef DISP_ENERGY_CAP
+	if (display.cap) {
+		if ((on_time == 0) || (on_time > display.cap)) { on_time = display.cap; }
+	}
+	#endif
+	if (on_time) {							// switch column off after on-time (see dmBlank)
+		OCR1A = TCNT1 + (on_time << 4);
+		TIMER1_IFR = (1<<OCF1A);			// clear pending compare match
+		TIMER1_IMSK |= (1<<OCIE1A);
+	}
+	#ifdef DISP_ENERGY_CAP
+	display.frame_leds += leds;
+	t = on_time;
+	if (t == 0) { t = 256; }				// always on -> whole column period
+	e = 0;									// e = leds * t
+	if (leds & 1) { e += t; }
+	if (leds & 2) { e += t << 1; }
+	if (leds & 4) { e += t << 2; }
+	#if DISP_ROWS > 7
+	if (leds & 8) { e += t << 3; }
+	#endif
+	display.energy += e;
+	#endif
+#endif
+	return (0);
+}
+#endif
+
+
+/*======================================================================
+	Function:		dmBlank
+	Input:			none
+	Output:			none
+	Description:	Switch off all columns of the led matrix until the next 
+					call of dmDisplay (all rows with row scanning).
+======================================================================*/
+void dmBlank(void)
+{
+	dmSetOutputs(DISP_LINES, 0);
+}
+
+
+#ifdef DISP_BRIGHTNESS
+/*======================================================================
+	Function:		dmSetBrightness
+	Input:			on-time in units of 16 cycles (0 = full brightness)
+	Output:			none
+	Description:	Set the time for which each column is switched on.
+					With on-time compensation this is the on-time of a column (or
+					a row with row scanning) with all leds lit. Sparse columns get
+					a shorter on-time. The compensation only dims: dense columns
+					cannot get more than the given on-time, so at full brightness
+					the sparse columns are dimmed down to the dense ones.
+======================================================================*/
+void dmSetBrightness(uint8_t on_time)
+{
+#ifdef DISP_COMPENSATION
+	uint8_t i;
+	uint16_t t, n;
+
+	t = on_time;
+	if (t == 0) { t = 256; }				// full brightness -> whole column period
+	for (i = 0; i < LINE_LEDS; i++) {
+		n = (t * pgm_read_byte(&comp_conv[i])) >> 4;
+		if (n == 0) { n = 1; }				// 0 would mean always on
+		display.on_time[i] = n;				// 256 (full brightness) -> 0 = always on
+	}
+	display.on_time[LINE_LEDS] = on_time;
+#else
+	display.on_time = on_time;
+#endif
+}
+#endif
+
+
+#ifdef DISP_ENERGY_CAP
+/*======================================================================
+	Function:		dmReadEnergy
+	Input:			clear flag (1 = reset energy counter after reading)
+	Output:			energy counter (number of lit leds times on-time in units of 16 cycles)
+	Description:	Read the energy counter of the display.
+======================================================================*/
+uint32_t dmReadEnergy(uint8_t clear)
+{
+	uint32_t energy;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		energy = display.energy;
+		if (clear) { display.energy = 0; }
+	}
+	return (energy);
+}
+#endif
+
+
+#ifdef DISP_RUNTIME_MATRIX
+/*======================================================================
+	Function:		dmTableEntry
+	Input:			pointer to table entry (values of the ports A, B and D)
+					bit pattern
+					number of pins
+					pointer to pin of bit 0 in pin_map
+					distance between the pins of two consecutive bits (1 or -1)
+	Output:			none
+	Description:	Set the port bits of the pins selected by the bit pattern.
+======================================================================*/
+static void dmTableEntry(uint8_t* entry, uint8_t pattern, uint8_t count, const uint8_t* pin, int8_t step)
+{
+	uint8_t p;
+
+	entry[A] = 0;
+	entry[B] = 0;
+	entry[D] = 0;
+	while (count) {
+		if (pattern & 1) {
+			p = pgm_read_byte(pin);
+			entry[p >> 4] |= (1 << (p & 0x07));
+		}
+		pattern >>= 1;
+		pin += step;
+		count--;
+	}
+}
+
+
+/*======================================================================
+	Function:		dmBuildTables
+	Input:			none
+	Output:			none
+	Description:	Build the output tables for the current matrix type, polarity 
+					and orientation.
+					Note: Inverting the pattern within the pins of a table gives the
+					same result as inverting the port bits (see POLARITY).
+======================================================================*/
+static void dmBuildTables(void)
+{
+	uint8_t n, orient, inv;
+	int8_t step;
+	const uint8_t* pin;
+
+	orient = 0;
+	#ifdef DISP_ORIENTATION
+	orient = (DISP_FLAGS >> DISP_MIRROR) & ORIENT_ROTATE;
+	#endif
+	#ifdef DISP_UPDOWN
+	orient ^= ORIENT_ROTATE;
+	#endif
+	inv = 0;
+	if (display.matrix & MATRIX_ANODE) { inv = 0xFF; }
+
+	// rows
+	pin = pin_map[display.matrix & MATRIX_HDSP5403];
+	step = 1;
+	if (orient & ORIENT_FLIP) { pin += DISP_ROWS - 1;  step = -1; }
+	for (n = 0; n < 16; n++) {
+		dmTableEntry(row_lo[n], n ^ inv, 4, pin, step);
+	}
+	pin += 4 * step;
+	for (n = 0; n < 8; n++) {
+		dmTableEntry(row_hi[n], n ^ inv, 3, pin, step);
+	}
+
+	// columns
+	pin = pin_map[display.matrix & MATRIX_HDSP5403] + DISP_ROWS;
+	step = 1;
+	if (orient & ORIENT_MIRROR) { pin += DISP_COLUMNS - 1;  step = -1; }
+	for (n = 0; n <= DISP_COLUMNS; n++) {
+		dmTableEntry(col_out[n], ~(1 << n) ^ inv, DISP_COLUMNS, pin, step);	// n = DISP_COLUMNS -> no column
+	}
+
+	#ifdef DISP_ANTI_GHOST
+	for (n = 0; n < 3; n++) {
+		all_off[n] = row_lo[0][n] | row_hi[0][n] | col_out[DISP_COLUMNS][n];
+	}
+	#endif
+}
+
+
+/*======================================================================
+	Function:		dmSetMatrix
+	Input:			matrix type and polarity (see MATRIX_HDSP5403 and MATRIX_ANODE)
+	Output:			none
+	Description:	Set the type and the polarity of the dot matrix display.
+					The tables are built with interrupts disabled so that the
+					display interrupt never outputs a half-built table.
+======================================================================*/
+void dmSetMatrix(uint8_t matrix)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		display.matrix = matrix;
+		dmBuildTables();
+	}
+}
+#endif
+
+
+#ifdef DISP_ORIENTATION
+/*======================================================================
+	Function:		dmSetOrientation
+	Input:			orientation (ORIENT_NORMAL, ORIENT_MIRROR, ORIENT_FLIP or ORIENT_ROTATE)
+	Output:			none
+	Description:	Set display orientation relative to the mounting given by DISP_UPDOWN.
+======================================================================*/
+void dmSetOrientation(uint8_t orient)
+{
+	orient = (orient & ORIENT_ROTATE) << DISP_MIRROR;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		DISP_FLAGS = (DISP_FLAGS & ~((1<<DISP_MIRROR) | (1<<DISP_FLIP))) | orient;
+		#ifdef DISP_RUNTIME_MATRIX
+		dmBuildTables();						// tables and flags change together
+		#endif
+	}
+}
+#endif
+
+
+#ifdef DISP_TEXT_MODE
+/*======================================================================
+	Function:		dmTextStep
+	Input:			direction (0 = forward, 1 = backward)
+	Output:			none
+	Description:	Move the window by one column (text mode).
+======================================================================*/
+static void dmTextStep(uint8_t backward)
+{
+	if (backward) {
+		if (display.base_offset)	{ display.base_offset--; }
+		else						{ display.base_char--;  display.base_offset = dmGlyphWidth(display.base_char); }
+		display.base_col--;
+	}
+	else {
+		if (dmGlyph(display.base_char, display.base_offset) & 0x80)	{ display.base_char++;  display.base_offset = 0; }
+		else														{ display.base_offset++; }
+		display.base_col++;
+	}
+}
+
+
+/*======================================================================
+	Function:		dmScrollText
+	Input:			scroll mode
+	Output:			status
+	Description:	Scroll display by one step (text mode). Returns 1 if end of 
+					scrolling range has been reached.
+======================================================================*/
+static uint8_t dmScrollText(uint8_t mode)
+{
+	uint8_t inc;
+	int16_t temp;
+
+	inc = mode & 0x0F;										// extract increment
+	if (mode & 0x10)	{ temp = display.base_col - inc; }	// scrolling backward
+	else				{ temp = display.base_col + inc; }	// scrolling forward
+
+	if ((temp < 0) || ((temp + DISP_WINDOW) >= (int16_t)display.text_cols)) {	// end of scrolling range reached?
+															// Note: The last spacing column is not part of the range.
+		if (display.delay_counter) {
+			display.delay_counter--;
+		}
+		else {
+			display.delay_counter = display.scroll_delay;					// reload delay counter
+			if (mode & 0x20)		{ display.scroll_mode = mode ^ 0x10; }	// reverse direction
+			else {
+				display.base_char = 0;										// restart from left end
+				display.base_offset = 0;
+				display.base_col = 0;
+				if (mode & 0x10) {											// restart from right end
+					temp = display.text_cols - 1 - DISP_WINDOW;
+					while (temp > 0) { dmTextStep(0);  temp--; }
+				}
+			}
+		}
+		return (1);
+	}
+	else {
+		mode &= 0x10;
+		while (inc) { dmTextStep(mode);  inc--; }
+		return (0);
+	}
+}
+#endif
+
+
+#ifdef DISP_RING
+/*======================================================================
+	Function:		dmScrollRing
+	Input:			scroll mode
+	Output:			status
+	Description:	Scroll display forward by one step (ring buffer). Returns 1 if
+					end of scrolling range has been reached.
+======================================================================*/
+static uint8_t dmScrollRing(uint8_t mode)
+{
+	uint16_t temp;
+
+	temp = display.ring_base + (mode & 0x0F);
+	if ((temp + DISP_WINDOW) > display.head) {				// end of content reached?
+		if ((display.ring_state == RING_FILL) || (display.ring_state == RING_REFILL)) {
+			return (0);										// wait for the renderer
+		}
+		if (display.delay_counter) {
+			display.delay_counter--;
+		}
+		else {
+			display.delay_counter = display.scroll_delay;	// reload delay counter
+			if (display.head <= DISP_MAX)	{ temp = 0; }	// first column is still in the ring
+			else if (display.ring_state == RING_COMPLETE) {
+				display.head = 0;							// let the renderer start over
+				display.ring_state = RING_REFILL;
+				temp = 0;
+			}
+			else							{ temp = display.head - DISP_MAX; }	// oldest column in the ring
+			display.ring_base = temp;
+		}
+		return (1);
+	}
+	else {
+		display.ring_base = temp;
+		return (0);
+	}
+}
+#endif
+
+
+/*======================================================================
+	Function:		dmScroll
+	Input:			none
+	Output:			status
+	Description:	Scroll display by one step. Returns 1 if end of scrolling range has been reached.
+					Call this function periodically, e. g. within an interrupt routine.
+======================================================================*/
+uint8_t dmScroll(void)
+{
+	uint8_t mode;
+	disp_pos_t temp;
+
+	if (DISP_FLAGS & (1<<DISP_HOLD)) { return (0); }		// no scrolling during display updates
+	mode = display.scroll_mode;
+	#ifdef DISP_TEXT_MODE
+	if (DISP_FLAGS & (1<<DISP_TEXT)) { return (dmScrollText(mode)); }
+	#endif
+	#ifdef DISP_RING
+	return (dmScrollRing(mode));
+	#endif
+	temp = mode & 0x0F;										// extract increment
+	if (mode & 0x10)	{ temp = DISP_BASE - DISP_START - temp; }	// scrolling backward
+															// We use a dirty trick here:
+															// Temp may underflow at left end of display memory.
+	else				{ temp = DISP_BASE - DISP_START + temp; }	// scrolling forward
+	#if DISP_MAX > 255
+	if (temp > DISP_RANGE) { temp = DISP_RANGE; }			// 16 bit positions are not promoted, so the
+	#endif													// underflow has to be caught explicitly
+	if ((temp + DISP_WINDOW) > DISP_RANGE) {				// end of scrolling range reached?
+															// Note: As temp is allowed to underflow, this is 
+															// true at both ends of the display memory.
+		if (display.delay_counter) {
+			display.delay_counter--;
+		}
+		else {
+			display.delay_counter = display.scroll_delay;					// reload delay counter
+			if (mode & 0x20)		{ display.scroll_mode = mode ^ 0x10; }	// reverse direction
+			else if (mode &0x10)	{ DISP_BASE = DISP_START + DISP_RANGE - DISP_WINDOW; }	// restart from right end
+			else					{ DISP_BASE = DISP_START; }			// restart from left end
+		}
+		return (1);
+	}
+	else {
+		DISP_BASE = temp + DISP_START;
+		return (0);
+	}
+}
+
+
+#ifdef DISP_VSCROLL
+/*======================================================================
+	Function:		dmScrollVertical
+	Input:			none
+	Output:			status
+	Description:	Scroll display vertically by one row. Returns 1 while the
+					content rests at its original position.
+					Call this function periodically, e. g. within an interrupt routine.
+======================================================================*/
+uint8_t dmScrollVertical(void)
+{
+	int8_t temp;
+
+	if (DISP_FLAGS & (1<<DISP_HOLD)) { return (0); }		// no scrolling during display updates
+	if (display.v_dir == VSCROLL_OFF) { return (0); }
+	temp = display.v_shift;
+	if (temp == 0) {										// content at original position?
+		if (display.v_counter) {
+			display.v_counter--;
+			return (1);
+		}
+		display.v_counter = display.v_delay;				// reload delay counter
+	}
+	if (display.v_dir == VSCROLL_UP) {
+		temp++;
+		if (temp > DISP_ROWS)	{ temp = 1 - DISP_ROWS; }	// roll in from the bottom
+	}
+	else {
+		temp--;
+		if (temp < -DISP_ROWS)	{ temp = DISP_ROWS - 1; }	// roll in from the top
+	}
+	display.v_shift = temp;
+	return (0);
+}
+
+
+/*======================================================================
+	Function:		dmSetVScrolling
+	Input:			direction (0 = off, 1 = up, 2 = down)
+					delay     (range 0..255)
+	Output:			none
+	Description:	Set vertical scrolling direction. Delay sets number of scrolling
+					steps to wait whenever the content is at its original position.
+======================================================================*/
+void dmSetVScrolling(uint8_t dir, uint8_t delay)
+{
+	display.v_shift = 0;
+	display.v_counter = delay;
+	display.v_delay = delay;
+	display.v_dir = dir;
+}
+#endif
+
+
+#ifdef DISP_LAYERS
+/*======================================================================
+	Function:		dmScrollBackground
+	Input:			none
+	Output:			none
+	Description:	Scroll the background layer by one step. The background is
+					repeated endlessly, so there is no end of the scrolling range.
+					Call this function periodically, e. g. within an interrupt routine.
+======================================================================*/
+void dmScrollBackground(void)
+{
+	uint16_t temp;
+
+	if (DISP_FLAGS & (1<<DISP_HOLD)) { return; }		// no scrolling during display updates
+	if (display.bg_len == 0) { return; }
+	temp = display.bg_base + display.bg_inc;
+	while (temp >= display.bg_len) { temp -= display.bg_len; }
+	display.bg_base = temp;
+}
+#endif
+
+
+/*======================================================================
+	Function:		dmSetScrolling
+	Input:			increment (range 0..15)
+					direction (0 = forward, 1 = backward, 2 = bidirectional)
+					delay     (range 0..255)
+	Output:			none
+	Description:	Set scrolling increment and direction.
+					Delay sets number of scrolling steps to wait at end of scrolling range.
+======================================================================*/
+void dmSetScrolling(uint8_t inc, uint8_t dir, uint8_t delay)
+{
+	inc &= 0x0F;		// limit range
+	dir &= 0x03;		// limit range
+	if (dir != BACKWARD)	{ display.delay_counter = delay; }
+	else					{ display.delay_counter = 0; }
+	swap(dir);
+	display.scroll_mode   = inc | dir;
+	display.scroll_delay  = delay;
+}
+
+
+#ifdef DISP_PAD
+/*======================================================================
+	Function:		dmSetPadding
+	Input:			number of blank columns (range 0..20, 0..DISP_WIDTH with DISP_SHIFT_OUT)
+	Output:			none
+	Description:	Set the number of blank columns before and after the display
+					content. They are part of the scrolling range but not stored.
+======================================================================*/
+void dmSetPadding(uint8_t pad)
+{
+	display.pad = pad;
+}
+#endif
+
+
+/*======================================================================
+	Function:		dmClearDisplay
+	Input:			none
+	Output:			none
+	Description:	Set display cursor to begin of display memory and 
+					clear visible part of display memory.
+======================================================================*/
+void dmClearDisplay(void)
+{
+	uint8_t i;
+
+	SET_POS(DISP_BASE, 0);
+	SET_POS(display.cursor, 0);
+	#ifdef DISP_SOURCES
+	display.sources = 0;
+	display.ram = 0;
+	#endif
+	#ifdef DISP_TEXT_MODE
+	DISP_FLAGS &= ~(1<<DISP_TEXT);
+	display.base_char = 0;
+	display.base_offset = 0;
+	display.base_col = 0;
+	display.text_cols = 0;
+	#endif
+	#ifdef DISP_PREFETCH
+	SET_POS(display.start, 0);
+	SET_POS(display.end, 0);
+	display.limit = DISP_MAX;
+	#endif
+	#ifdef DISP_RING
+	display.ring_base = 0;
+	display.head = 0;
+	display.ring_state = RING_STATIC;
+	#endif
+	#ifdef DISP_ATTRIBUTES
+	display.attrs = 0;
+	#endif
+	#ifdef DISP_VSCROLL
+	display.v_dir = VSCROLL_OFF;
+	display.v_shift = 0;
+	#endif
+	#ifdef DISP_LAYERS
+	display.bg_len = 0;
+	display.layer_op = LAYER_OR;
+	#endif
+	for (i = 0; i < DISP_WINDOW; i++) {
+		PUT_COLUMN(i, 0);
+	}
+}
+
+
+#ifdef DISP_TEXT_MODE
+/*======================================================================
+	Function:		dmSetTextMode
+	Input:			none
+	Output:			none
+	Description:	Clear the display and switch to text mode. Until the next call
+					of dmClearDisplay, dmPrintChar stores characters instead of
+					their columns.
+======================================================================*/
+void dmSetTextMode(void)
+{
+	dmClearDisplay();
+	DISP_FLAGS |= (1<<DISP_TEXT);
+}
+#endif
+
+
+/*======================================================================
+	Function:		dmBeginUpdate
+	Input:			none
+	Output:			none
+	Description:	Switch off the display at the start of the next frame and wait
+					until this has happened. The display memory can then be rewritten
+					without showing half-rendered content. Scrolling is suspended
+					until dmCommit is called.
+					Note: Do not call this function from an interrupt routine.
+======================================================================*/
+void dmBeginUpdate(void)
+{
+	DISP_FLAGS |= (1<<DISP_HOLD);
+	while ((DISP_FLAGS & (1<<DISP_BLANK)) == 0) {}		// wait for start of next frame
+}
+
+
+/*======================================================================
+	Function:		dmCommit
+	Input:			none
+	Output:			none
+	Description:	Show the display content written since dmBeginUpdate starting 
+					with its first column. The display is switched on again at the
+					start of the next frame.
+======================================================================*/
+void dmCommit(void)
+{
+	SET_POS(DISP_BASE, DISP_START);
+	DISP_FLAGS &= ~(1<<DISP_HOLD);
+}
+
+
+#ifdef DISP_PREFETCH
+/*======================================================================
+	Function:		dmBeginPrefetch
+	Input:			none
+	Output:			1 = prefetch started, 0 = not enough free display memory
+	Description:	Move the cursor to the larger free area of the display memory.
+					Until dmEndPrefetch is called, all output goes to this area
+					without affecting the displayed content.
+======================================================================*/
+uint8_t dmBeginPrefetch(void)
+{
+	uint8_t i;
+	disp_pos_t pos, lim;
+
+	pos = display.end;
+	if (pos < display.start + DISP_WINDOW) { pos = display.start + DISP_WINDOW; }	// keep visible window
+	lim = DISP_MAX;
+	if ((DISP_MAX - pos) < display.start)	{ pos = 0;  lim = display.start; }	// use area before content
+	if ((disp_pos_t)(lim - pos) <= DISP_WINDOW) { return (0); }
+	for (i = 0; i < DISP_WINDOW; i++) {
+		PUT_COLUMN(pos + i, 0);
+	}
+	DISP_FLAGS |= (1<<DISP_DEFER);
+	display.next_start = pos;
+	display.cursor = pos;
+	display.limit = lim;
+	return (1);
+}
+
+
+/*======================================================================
+	Function:		dmEndPrefetch
+	Input:			none
+	Output:			1 = prefetched content is complete, 0 = content was truncated
+	Description:	End the output to the free area and move the cursor back to
+					the end of the displayed content. If the prefetched content is
+					complete it can be shown by dmFlip.
+======================================================================*/
+uint8_t dmEndPrefetch(void)
+{
+	disp_pos_t pos, lim;
+
+	pos = display.cursor;
+	lim = display.limit;
+	DISP_FLAGS &= ~(1<<DISP_DEFER);
+	display.cursor = display.end;
+	display.limit = DISP_MAX;
+	if (pos >= lim) { return (0); }			// free area has been filled up
+	if (pos < display.next_start + DISP_WINDOW) { pos = display.next_start + DISP_WINDOW; }
+	display.next_end = pos;
+	return (1);
+}
+
+
+/*======================================================================
+	Function:		dmFlip
+	Input:			none
+	Output:			none
+	Description:	Show the prefetched content starting with its first column.
+					Waits for the end of the current frame so that the change
+					takes effect with the next frame.
+					Note: Do not call this function from an interrupt routine.
+======================================================================*/
+void dmFlip(void)
+{
+	DISP_FLAGS &= ~(1<<DISP_SYNC);
+	while ((DISP_FLAGS & (1<<DISP_SYNC)) == 0) {}		// wait for end of frame
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		display.start = display.next_start;
+		display.end = display.next_end;
+		display.cursor = display.next_end;
+		DISP_BASE = display.next_start;
+	}
+}
+#endif
+
+
+#ifdef DISP_SOURCES
+/*======================================================================
+	Function:		dmAddSource
+	Input:			source type
+					address of first column
+					number of columns
+	Output:			1 = columns have been added, 0 = no free source descriptor
+	Description:	Append columns to the displayed content. Consecutive columns
+					of the same source extend the last source descriptor.
+					The last descriptor is kept for the display memory, so that
+					images can still be copied when the descriptors run out.
+======================================================================*/
+static uint8_t dmAddSource(uint8_t type, const uint8_t* adr, disp_pos_t len)
+{
+	source_t* src;
+
+	if (len > (disp_pos_t) ~display.cursor) { len = ~display.cursor; }	// limit range of positions
+	if (len == 0) { return (1); }
+	src = &display.source[display.sources];			// next free source descriptor
+	if ((display.sources) && ((src - 1)->type == type) && ((src - 1)->adr + (src - 1)->len == adr)) {
+		SET_POS((src - 1)->len, (src - 1)->len + len);	// continue last source
+	}
+	else {
+		if (display.sources >= DISP_SOURCE_COUNT - (type != SRC_RAM)) { return (0); }	// keep last one for RAM
+		src->type = type;
+		src->adr = adr;
+		src->len = len;									// must be set before the source is counted
+		display.sources++;
+	}
+	SET_POS(display.cursor, display.cursor + len);
+	return (1);
+}
+
+
+/*======================================================================
+	Function:		dmSetRamCursor
+	Input:			new index of first free byte of display memory
+	Output:			none
+	Description:	Add the columns written to the display memory to the
+					displayed content.
+======================================================================*/
+static void dmSetRamCursor(disp_pos_t pos)
+{
+	if (dmAddSource(SRC_RAM, &display.memory[display.ram], pos - display.ram)) {
+		display.ram = pos;
+	}
+}
+
+
+/*======================================================================
+	Function:		dmDisplayEEImage
+	Input:			pointer to graphics data in EEPROM memory
+	Output:			pointer behind the end-of-data marker
+	Description:	Show EEPROM contents at current cursor position until the 
+					end-of-data marker (0xFF) is reached. The data is read by the
+					display interrupt. If all source descriptors are in use, it is
+					copied to the display memory.
+======================================================================*/
+uint8_t* dmDisplayEEImage(uint8_t* ee_adr)
+{
+	disp_pos_t len = 0;
+
+	while (eeprom_read_byte(ee_adr + len) != 0xFF) { len++; }
+	if (dmAddSource(SRC_EEPROM, ee_adr, len) == 0) {
+		while (len) {
+			dmPrintByte(eeprom_read_byte(ee_adr++));
+			len--;
+		}
+	}
+	return (ee_adr + len + 1);
+}
+#endif
+
+
+#ifdef DISP_RING
+/*======================================================================
+	Function:		dmRingFree
+	Input:			none
+	Output:			number of free columns
+	Description:	Return the number of columns that can be written to the ring
+					buffer without overwriting the visible window or columns ahead
+					of it.
+======================================================================*/
+uint8_t dmRingFree(void)
+{
+	uint16_t used;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		used = display.head - display.ring_base;
+	}
+	return (DISP_MAX - used);
+}
+
+
+/*======================================================================
+	Function:		dmRingState
+	Input:			none
+	Output:			ring state (see RING_STATIC etc.)
+	Description:	Return the state of the ring buffer content.
+======================================================================*/
+uint8_t dmRingState(void)
+{
+	return (display.ring_state);
+}
+
+
+/*======================================================================
+	Function:		dmSetRingState
+	Input:			ring state (see RING_STATIC etc.)
+	Output:			none
+	Description:	Set the state of the ring buffer content. A renderer sets
+					RING_FILL when it starts (after dmClearDisplay) or starts over
+					and RING_COMPLETE after the last column.
+======================================================================*/
+void dmSetRingState(uint8_t state)
+{
+	display.ring_state = state;
+}
+#endif
+
+
+#ifdef DISP_ATTRIBUTES
+/*======================================================================
+	Function:		dmSetAttribute
+	Input:			index of first column in display memory
+					number of columns (0 = up to the end)
+					attributes (ATTR_INVERT, ATTR_HIDE and/or ATTR_BLINK(rate))
+	Output:			1 = ok, 0 = no free attribute region
+	Description:	Apply attributes to a region of the display memory. Regions
+					are removed by dmClearDisplay.
+======================================================================*/
+uint8_t dmSetAttribute(disp_pos_t first, disp_pos_t count, uint8_t attr)
+{
+	attr_t* region;
+	uint8_t rate, blink = 0;
+
+	if (display.attrs >= DISP_ATTR_COUNT) { return (0); }
+	rate = (attr >> 4) & 0x07;
+	if (rate > ATTR_BLINK_MAX) { rate = ATTR_BLINK_MAX; }
+	if (rate) {
+		blink = 0x80;
+		while (--rate) { blink >>= 1; }
+	}
+	region = &display.attr[display.attrs];
+	region->first = first;
+	if (count)	{ region->last = first + count - 1; }
+		else	{ region->last = ATTR_OPEN; }
+	region->attr = attr;
+	region->blink = blink;
+	display.attrs++;								// the region is complete before it is used
+	return (1);
+}
+
+
+/*======================================================================
+	Function:		dmMarkAttribute
+	Input:			attributes (ATTR_INVERT, ATTR_HIDE and/or ATTR_BLINK(rate))
+	Output:			none
+	Description:	Start a region with the given attributes at the cursor position
+					or end it there if such a region has been started before.
+					A region that is not ended extends up to the end. A region
+					that is ended where it starts has no effect.
+======================================================================*/
+void dmMarkAttribute(uint8_t attr)
+{
+	attr_t* region;
+	uint8_t i;
+
+	region = display.attr;
+	for (i = display.attrs; i; i--) {
+		if ((region->last == ATTR_OPEN) && (region->attr == attr)) {
+			if (region->first == display.cursor) {	// empty region
+				region->attr = 0;
+				region->blink = 0;
+				SET_POS(region->last, region->first);
+				if (i == 1) { display.attrs--; }	// free it if it is the last one
+			}
+			else {
+				SET_POS(region->last, display.cursor - 1);	// end of region
+			}
+			return;
+		}
+		region++;
+	}
+	dmSetAttribute(display.cursor, 0, attr);		// start of region
+}
+#endif
+
+
+#ifdef DISP_LAYERS
+/*======================================================================
+	Function:		dmSetBackground
+	Input:			pointer to graphics data in flash memory (0 = no background)
+					scrolling increment of the background
+	Output:			none
+	Description:	Show an image as background layer of the display content.
+					The image is read from flash by the display interrupt and
+					repeated endlessly (up to 255 columns). The background is
+					removed by dmClearDisplay.
+======================================================================*/
+void dmSetBackground(const uint8_t* image, uint8_t inc)
+{
+	uint8_t len = 0;
+
+	if (image) {
+		while ((len < 255) && (pgm_read_byte(image + len) != 0xFF)) { len++; }
+	}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		display.bg_image = image;
+		display.bg_len = len;
+		display.bg_base = 0;
+		display.bg_inc = inc;
+	}
+}
+
+
+/*======================================================================
+	Function:		dmSetLayerMode
+	Input:			combination of the layers (see LAYER_OR etc.)
+	Output:			none
+	Description:	Set how the display content is combined with the background.
+======================================================================*/
+void dmSetLayerMode(uint8_t op)
+{
+	display.layer_op = op;
+}
+#endif
+
+
+/*======================================================================
+	Function:		dmDisplayImage
+	Input:			pointer to graphics data in flash memory
+	Output:			none
+	Description:	Copy flash contents to display memory at current cursor position 
+					until the end-of-data marker (0xFF) is reached.
+					With source descriptors the image is read from flash by the
+					display interrupt instead of being copied.
+					In ring mode columns that do not fit into the ring are dropped.
+======================================================================*/
+void dmDisplayImage(const uint8_t* image)
+{
+	uint8_t img_data;
+	disp_pos_t pos;
+
+	#ifdef DISP_SOURCES
+	pos = 0;
+	while (pgm_read_byte(image + pos) != 0xFF) { pos++; }
+	if (dmAddSource(SRC_FLASH, image, pos)) { return; }
+	#endif
+	#ifdef DISP_RING
+	img_data = pgm_read_byte(image++);
+	while (img_data != 0xFF) {
+		dmPrintByte(img_data);
+		img_data = pgm_read_byte(image++);
+	}
+	return;
+	#endif
+	pos = RAM_CURSOR;
+	while(pos < DISP_LIMIT) {
+		img_data = pgm_read_byte(image++);	// read byte from flash
+		if (img_data == 0xFF) { break; }	// stop if end-of-data has been reached
+		PUT_COLUMN(pos, img_data);
+		pos++;
+	}
+	SET_CURSOR(pos);
+}
+
+
+#ifdef DISP_GRAYSCALE
+/*======================================================================
+	Function:		dmDisplayGrayImage
+	Input:			pointer to grayscale graphics data in flash memory
+	Output:			none
+	Description:	Copy grayscale graphics to display memory at current cursor position
+					until the end-of-data marker (0xFF) is reached.
+					Every column is encoded by two bytes: The first byte holds the
+					most significant bits of the brightness levels, the second byte
+					holds the least significant bits.
+======================================================================*/
+void dmDisplayGrayImage(const uint8_t* image)
+{
+	uint8_t msb, lsb;
+	disp_pos_t pos;
+
+	pos = RAM_CURSOR;
+	while(pos < DISP_LIMIT) {
+		msb = pgm_read_byte(image++);		// read byte from flash
+		if (msb == 0xFF) { break; }			// stop if end-of-data has been reached
+		lsb = pgm_read_byte(image++);
+		display.memory[pos] = msb;
+		display.shade[pos] = msb ^ lsb;		// short phase shows memory XOR shade = lsb
+		pos++;
+	}
+	SET_CURSOR(pos);
+}
+#endif
+
+
+/*======================================================================
+	Function:		dmPrintByte
+	Input:			byte
+	Output:			none
+	Description:	Write byte directly to the display memory.
+					In text mode bytes are ignored as the spacing between the
+					characters is added by the display interrupt.
+					In ring mode the byte is dropped if the ring is full.
+======================================================================*/
+void dmPrintByte(uint8_t byt)
+{
+	disp_pos_t pos;
+
+	#ifdef DISP_TEXT_MODE
+	if (DISP_FLAGS & (1<<DISP_TEXT)) { return; }
+	#endif
+	#ifdef DISP_RING
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {		// the display interrupt reads display.head
+		if ((uint16_t)(display.head - display.ring_base) < DISP_MAX) {
+			display.memory[(uint8_t)display.head & (DISP_MAX - 1)] = byt;
+			display.head++;
+		}
+	}
+	return;
+	#endif
+	pos = RAM_CURSOR;
+	if (pos < DISP_LIMIT) { 
+		PUT_COLUMN(pos, byt);
+		pos++;
+		SET_CURSOR(pos);
+	}
+}
+
+
+/*======================================================================
+	Function:		dmPrintChar
+	Input:			character code
+	Output:			none
+	Description:	Print character to display memory at current display cursor.
+======================================================================*/
+void dmPrintChar(uint8_t ch)
+{
+	uint8_t  i, char_data;
+	disp_pos_t pos;
+	uint16_t fnt;			// pointer into character font
+
+	// mapping of german special characters
+	if (ch == 223) { ch = 138; }		// ''
+	if (ch == 196) { ch = 133; }		// ''
+	if (ch == 214) { ch = 135; }		// ''
+	if (ch == 220) { ch = 137; }		// ''
+	if (ch == 228) { ch = 132; }		// ''
+	if (ch == 246) { ch = 134; }		// ''
+	if (ch == 252) { ch = 136; }		// ''
+	ch -= 32;
+	if (ch > (sizeof(font)/CHAR_WIDTH)) { return; }
+
+	#ifdef DISP_TEXT_MODE
+	if (DISP_FLAGS & (1<<DISP_TEXT)) {		// store font index
+		pos = display.cursor;
+		if (pos < DISP_MAX) {
+			display.memory[pos] = ch;
+			display.text_cols += dmGlyphWidth(pos) + 1;
+			SET_POS(display.cursor, pos + 1);
+		}
+		return;
+	}
+	#endif
+		
+	fnt = ch;
+	fnt = (fnt << 2) + fnt + (uint16_t) &font[0];		// fnt = &font + 5 * ch
+	
+	pos = RAM_CURSOR;
+	for (i = 0; i < CHAR_WIDTH; i++) {
+		char_data = pgm_read_byte(fnt++);	// read byte from font
+		if (char_data & 0x80) { break; }	// stop if MSB is set (proportional character width)
+		#ifdef DISP_RING
+		dmPrintByte(char_data);
+		#else
+		if (pos < DISP_LIMIT) {
+			PUT_COLUMN(pos, char_data);
+			pos++;
+		}		
+		#endif
+	}
+	SET_CURSOR(pos);
+}
+
+
+#ifdef DISP_GRAPHICS
+/*======================================================================
+	Function:		dmShift
+	Input:			column byte
+					number of rows to shift down (negative = up)
+	Output:			shifted column byte
+	Description:	Move a column byte to row y.
+======================================================================*/
+static uint8_t dmShift(uint8_t byt, int8_t y)
+{
+	if (y < 0)	{ return (byt >> -y); }
+	else		{ return (byt << y); }
+}
+
+
+/*======================================================================
+	Function:		dmDrawColumn
+	Input:			column (relative to the start of the displayed content)
+					mask of affected rows
+					data
+					drawing operation (DRAW_OR, DRAW_CLEAR, DRAW_XOR, DRAW_AND or DRAW_COPY)
+	Output:			none
+	Description:	Combine a column of the display memory with data. 
+					Columns outside the displayed content (or the window if the
+					content is shorter) are ignored, so that a prefetched message
+					is not affected.
+					In text mode nothing is drawn as the display memory holds
+					characters instead of columns.
+======================================================================*/
+static void dmDrawColumn(int16_t x, uint8_t mask, uint8_t data, uint8_t op)
+{
+	uint8_t* col;
+	disp_pos_t end;
+
+	#ifdef DISP_TEXT_MODE
+	if (DISP_FLAGS & (1<<DISP_TEXT)) { return; }
+	#endif
+	if (x < 0) { return; }
+	end = DISP_END;
+	if (end < DISP_START + DISP_WINDOW) { end = DISP_START + DISP_WINDOW; }	// visible window
+	if (x >= (int16_t)(end - DISP_START)) { return; }
+	x += DISP_START;
+	mask &= ALL_ROWS;
+	data &= mask;
+	col = &display.memory[x];
+	switch (op) {
+		case DRAW_OR:		*col |= data;  break;
+		case DRAW_CLEAR:	*col &= ~data;  break;
+		case DRAW_XOR:		*col ^= data;  break;
+		case DRAW_AND:		*col &= data | ~mask;  break;
+		case DRAW_COPY:		*col = (*col & ~mask) | data;  break;
+	}
+	#ifdef DISP_GRAYSCALE
+	display.shade[x] &= ~mask;						// drawn pixels have full brightness
+	#endif
+}
+
+
+/*======================================================================
+	Function:		dmFillRect
+	Input:			left column (relative to the start of the displayed content)
+					top row (0 = row 1, may be negative)
+					width
+					height (range 0..8)
+					drawing operation (DRAW_OR, DRAW_CLEAR, DRAW_XOR, DRAW_AND or DRAW_COPY)
+	Output:			none
+	Description:	Draw a filled rectangle. Pixels, horizontal and vertical lines are
+					drawn as rectangles of width or height 1 (see dot_matrix.h).
+					The cursor is not changed.
+======================================================================*/
+void dmFillRect(int16_t x, int8_t y, uint8_t w, uint8_t h, uint8_t op)
+{
+	uint8_t mask;
+
+	mask = dmShift(~(0xFF << h), y);
+	while (w) {
+		dmDrawColumn(x, mask, 0xFF, op);
+		x++;
+		w--;
+	}
+}
+
+
+/*======================================================================
+	Function:		dmBlit
+	Input:			left column (relative to the start of the displayed content)
+					top row (0 = row 1, may be negative)
+					pointer to sprite data in flash memory
+					pointer to mask in flash memory (0 = no mask)
+					drawing operation (DRAW_OR, DRAW_CLEAR, DRAW_XOR, DRAW_AND or DRAW_COPY)
+	Output:			none
+	Description:	Draw a sprite. Sprite data has the same format as images: one
+					byte per column terminated by the end-of-data marker (0xFF).
+					The mask has one byte per column of the sprite and selects the
+					affected rows. Without a mask all rows are affected.
+					The cursor is not changed.
+======================================================================*/
+void dmBlit(int16_t x, int8_t y, const uint8_t* sprite, const uint8_t* mask, uint8_t op)
+{
+	uint8_t data, m;
+
+	data = pgm_read_byte(sprite++);
+	while (data != 0xFF) {
+		m = 0xFF;
+		if (mask) { m = pgm_read_byte(mask++); }
+		dmDrawColumn(x, dmShift(m, y), dmShift(data, y), op);
+		x++;
+		data = pgm_read_byte(sprite++);
+	}
+}
+#endif
 
 
 /*======================================================================
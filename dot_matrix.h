@@ -39,9 +39,343 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
 //#define DISP_UPDOWN						// if defined -> display is upside down
 #define DOT_MATRIX_TYPE		Tx07-11		// choose Tx07-11 (Kingbright) or HDSP5403 (Hewlett Packard)
 //#define DOT_MATRIX_TYPE		HDSP5403
+//#define DISP_FAST_ISR						// if defined -> use the hand-tuned display interrupt (see Hacklace.c)
+//#define DISP_GRAYSCALE					// if defined -> 4 brightness levels per pixel (halves DISP_MAX)
+//#define DISP_BRIGHTNESS					// if defined -> global brightness control (uses timer 1)
+//#define DISP_COMPENSATION					// if defined -> adapt on-time to number of lit leds per column
+//#define DISP_ENERGY_CAP					// if defined -> limit average led current and count led-milliseconds
+#define DISP_ENERGY_BUDGET	12			// max. number of lit leds per frame at full on-time (energy cap)
+//#define DISP_PREFETCH						// if defined -> render the next message in advance (see dmBeginPrefetch)
+//#define DISP_ORIENTATION					// if defined -> orientation can be changed at runtime (see dmSetOrientation)
+//#define DISP_RUNTIME_MATRIX				// if defined -> matrix type and polarity can be changed at runtime (see dmSetMatrix)
+//#define DISP_GRAPHICS						// if defined -> drawing functions (see dmFillRect and dmBlit)
+//#define DISP_TEXT_MODE					// if defined -> store text as one byte per character (see dmSetTextMode)
+//#define DISP_SOURCES						// if defined -> show images directly from flash or EEPROM (see dmDisplayImage)
+#define DISP_SOURCE_COUNT	8			// max. number of source descriptors
+//#define DISP_ROW_SCAN						// if defined -> multiplex the rows instead of the columns
+//#define DISP_INTERLACE					// if defined -> scan in the order of DISP_COLUMN_ORDER (DISP_ROW_ORDER)
+//#define DISP_COLUMN_ORDER	{0, 2, 4, 1, 3}			// interlaced scan sequence of the columns (default: even ones first)
+//#define DISP_ROW_ORDER	{0, 2, 4, 6, 1, 3, 5}	// interlaced scan sequence of the rows (row scanning, default: even ones first)
+//#define DISP_SHIFT_OUT					// if defined -> further modules on shift registers widen the window to DISP_WIDTH
+#define DISP_WIDTH			15			// number of columns of the window with DISP_SHIFT_OUT (range DISP_COLUMNS + 1 .. DISP_COLUMNS + 32)
+//#define DISP_ANTI_GHOST					// if defined -> switch off all leds before the next column is set up
+//#define DISP_PAD							// if defined -> blank columns before and after the content are not stored (see dmSetPadding)
+//#define DISP_ATTRIBUTES					// if defined -> invert, blink or hide regions of the display content (see dmSetAttribute)
+#define DISP_ATTR_COUNT		4			// max. number of attribute regions
+//#define DISP_VSCROLL						// if defined -> display content can roll up or down (see dmSetVScrolling)
+//#define DISP_LAYERS						// if defined -> animated background behind the display content (see dmSetBackground)
+//#define DISP_RING							// if defined -> display memory is a ring buffer refilled while scrolling (see dmRingFree)
+
+// number of columns of the window
+#ifdef DISP_SHIFT_OUT
+	#define DISP_WINDOW		DISP_WIDTH
+#else
+	#define DISP_WINDOW		DISP_COLUMNS
+#endif
 
 // display memory
-#define DISP_MAX			200			// size of display memory in bytes (1 byte = 1 column, range 5..200)
+#if defined(HAL_LARGE_MEMORY) && defined(DISP_GRAYSCALE)
+	#define DISP_MAX		600			// ATmega328P (see hal.h): two planes of 600 bytes
+#elif defined(HAL_LARGE_MEMORY) && !defined(DISP_RING)
+	#define DISP_MAX		1200		// ATmega328P (see hal.h): 2 KB of RAM
+#elif defined(DISP_GRAYSCALE)
+	#define DISP_MAX		100			// grayscale needs a second memory plane of the same size
+#elif defined(DISP_RING)
+	#define DISP_MAX		64			// size of the ring buffer (must be a power of 2)
+#elif defined(DISP_RUNTIME_MATRIX)
+	#define DISP_MAX		110			// the output tables need 90 bytes of RAM
+#elif defined(DISP_SOURCES)
+	#define DISP_MAX		160			// the source descriptors need 4 bytes each
+#elif defined(DISP_SHIFT_OUT)
+	#define DISP_MAX		152			// the module rows need up to 28 bytes (plus the attribute regions)
+#elif defined(DISP_ATTRIBUTES)
+	#define DISP_MAX		184			// the attribute regions need 4 bytes each
+#else
+	#define DISP_MAX		200			// size of display memory in bytes (1 byte = 1 column, range 5..200)
+#endif
+
+// Positions in the display memory are 8 bit wide unless the display memory is larger
+// than 255 bytes. The hand-tuned display interrupt keeps the window base in GPIOR2.
+#if DISP_MAX > 255
+	typedef uint16_t disp_pos_t;
+#else
+	typedef uint8_t disp_pos_t;
+#endif
+#if (DISP_MAX > 255) && defined(DISP_FAST_ISR)
+	#error "DISP_FAST_ISR requires a display memory of up to 255 bytes"
+#endif
+
+// grayscale mode
+// Every column is displayed in a long phase showing display.memory followed by a
+// short phase of half the length showing display.memory XOR display.shade (binary
+// code modulation). A pixel set in display.memory only is shown at full brightness
+// so that text and 1 bit animations look the same as without grayscale mode.
+// Brightness levels:	memory	shade
+//		3 (full)		1		0
+//		2				1		1
+//		1				0		1
+//		0 (off)			0		0
+// The display interrupt runs twice per column, i. e. at 2 kHz. Each call needs roughly
+// 150 cycles including the register frame, which is about 8 % of the CPU time at 4 MHz
+// (estimated from the code, see MEASURE_ISR in config.h for measuring it on the target).
+#if defined(DISP_GRAYSCALE) && defined(DISP_FAST_ISR)
+	#error "DISP_GRAYSCALE cannot be used with DISP_FAST_ISR"
+#endif
+
+// brightness control
+// Timer 1 runs freely at the processor clock. When a column is switched on, compare
+// channel A of timer 1 is set up to switch it off again after the on-time has elapsed.
+// The on-time is given in units of 16 processor cycles (0 = column stays on for the
+// whole column period).
+#if defined(DISP_BRIGHTNESS) && (defined(DISP_FAST_ISR) || defined(DISP_GRAYSCALE))
+	#error "DISP_BRIGHTNESS cannot be used with DISP_FAST_ISR or DISP_GRAYSCALE"
+#endif
+
+// on-time compensation
+// A column pin has to sink the current of all lit leds of the column, so columns with
+// many lit leds look dimmer than sparse ones. With on-time compensation the on-time of
+// a column is shortened according to the number of its lit leds. At full brightness
+// a column with all leds lit stays on for the whole column period.
+// As the on-time is only shortened, sparse columns are dimmed to match the dense ones.
+// With row scanning the lit leds of each row are counted instead.
+// Note: This assumes a column period of at least 4096 cycles (COLUMN_FREQ <= 976 Hz at 4 MHz).
+#if defined(DISP_COMPENSATION) && !defined(DISP_BRIGHTNESS)
+	#error "DISP_COMPENSATION requires DISP_BRIGHTNESS"
+#endif
+
+// energy cap
+// The display interrupt counts the lit leds of every frame. If a frame has more than
+// DISP_ENERGY_BUDGET lit leds the on-time of the following frame is reduced so that
+// the average current stays the same as for DISP_ENERGY_BUDGET leds at full on-time.
+// The energy counter sums up the number of lit leds times their on-time in units
+// of 16 cycles.
+#if defined(DISP_ENERGY_CAP) && !defined(DISP_BRIGHTNESS)
+	#error "DISP_ENERGY_CAP requires DISP_BRIGHTNESS"
+#endif
+
+// row scanning
+// The display interrupt switches on one row at a time instead of one column. A row
+// pin then sources the current of up to 5 leds instead of a column pin sinking the
+// current of up to 7 leds, which gives a lower peak pin current and more even
+// brightness on matrices without current limiting resistors.
+//						column scanning		row scanning
+//		interrupts per frame	5					7
+//		duty cycle per led		1/5 (20 %)			1/7 (14 %)
+//		frame rate				195 Hz				139 Hz		(at 976 Hz interrupt rate)
+//		peak leds per pin		7					5
+// The visible columns are read and transposed into row patterns at the start of a
+// frame, so the first interrupt of a frame takes several hundred cycles longer than
+// the others (estimated from the code, see MEASURE_ISR in config.h for measuring the
+// interrupt duration on the target).
+// The output tables row_sel[] and col_lit[] replace row_lo[], row_hi[] and col_out[].
+#if defined(DISP_ROW_SCAN) && (defined(DISP_FAST_ISR) || defined(DISP_GRAYSCALE) || defined(DISP_RUNTIME_MATRIX))
+	#error "DISP_ROW_SCAN cannot be used with DISP_FAST_ISR, DISP_GRAYSCALE or DISP_RUNTIME_MATRIX"
+#endif
+
+// interlaced scanning
+// The columns (rows with DISP_ROW_SCAN) are scanned in the order of a table instead of
+// one after another. Neighbouring columns are then lit at different times of a frame,
+// which avoids the rolling shutter look of a sequential scan and flickers less at a low
+// column frequency. The scan sequence has to contain every column exactly once.
+// The window is read at the start of a frame, so a scrolling step always takes effect
+// for a whole frame and never in the middle of it.
+#if defined(DISP_INTERLACE) && (defined(DISP_FAST_ISR) || defined(DISP_GRAYSCALE))
+	#error "DISP_INTERLACE cannot be used with DISP_FAST_ISR or DISP_GRAYSCALE"
+#endif
+
+// anti-ghosting
+// The ports A, B and D are written one after another when the display switches to the
+// next column. Without anti-ghosting the new column may be switched on while some rows
+// still show the pattern of the previous column (or vice versa), which is visible as
+// faint ghost pixels. With anti-ghosting the ports that hold column pins (B and D for
+// both supported matrix types) are first set to switch off all their leds. Then the
+// ports are written with their new values in the order A, B, D. At no time a column
+// is on with rows of another column; if the new column is on port B, it shows the rows
+// on port D one write later. This costs two port writes per column.
+// Dead time between the previous column going off and the new column going on in the
+// hand-tuned display interrupt: 8 to 16 cycles (2 to 4 us at 4 MHz), counted from the
+// instruction sequence. The cost per interrupt can be measured on the target with
+// MEASURE_ISR (see config.h) by comparing the reported duration with and without
+// DISP_ANTI_GHOST.
+
+// display flags
+// The flags are kept in a general purpose I/O register, so they can be tested and
+// changed by single cycle bit instructions.
+#define DISP_FLAGS			GPIOR0
+#define DISP_SYNC			0			// set by the display interrupt after the last column of a frame
+#define DISP_HOLD			1			// request to switch off the display (see dmBeginUpdate)
+#define DISP_BLANK			2			// display is switched off for the current frame
+#define DISP_DEFER			3			// content is rendered into the spare area (prefetch)
+#define DISP_MIRROR			4			// columns in reverse order (orientation)
+#define DISP_FLIP			5			// rows in reverse order (orientation)
+#define DISP_TEXT			6			// display memory holds characters (text mode)
+
+// orientations (relative to the mounting given by DISP_UPDOWN)
+#define ORIENT_NORMAL		0
+#define ORIENT_MIRROR		1			// mirrored horizontally
+#define ORIENT_FLIP			2			// flipped vertically
+#define ORIENT_ROTATE		3			// rotated by 180 degrees (mirrored and flipped)
+
+// runtime matrix type
+// The output tables are built in RAM from the pin map of the selected matrix type,
+// so that one firmware image serves both types and polarities. Reading the tables
+// from RAM is even faster than reading them from flash.
+// A change of the orientation rebuilds the tables instead of switching between two
+// sets of tables.
+#define MATRIX_HDSP5403		0x01		// matrix type (0 = Tx07-11, 1 = HDSP5403)
+#define MATRIX_ANODE		0x02		// 1 = common column anode, 0 = common column cathode
+#if defined(DISP_RUNTIME_MATRIX) && defined(DISP_GRAYSCALE)
+	#error "DISP_RUNTIME_MATRIX cannot be used with DISP_GRAYSCALE (not enough RAM)"
+#endif
+#if defined(DISP_ORIENTATION) && !defined(DISP_RUNTIME_MATRIX)
+	#define DISP_ORIENTATION_TABLES				// orientation selects one of two sets of output tables
+#endif
+
+// prefetch
+// The displayed content occupies only part of the display memory. The next message
+// can be rendered into the larger one of the free areas before and after it while
+// the current message is still shown. dmFlip then only changes the displayed range
+// of the display memory, which is done at the end of a frame.
+
+// text mode
+// In text mode the display memory holds one font index per character instead of the
+// columns of the characters. The display interrupt walks through the characters and
+// reads the visible columns from the font, which is about five times more compact.
+// Window position and scrolling range are counted in columns (up to 65535).
+// Text mode is set per message and ended by dmClearDisplay. Columns that are not
+// part of a character (images, direct bytes, drawing) require the normal mode.
+#if defined(DISP_TEXT_MODE) && (defined(DISP_FAST_ISR) || defined(DISP_GRAYSCALE) || defined(DISP_PREFETCH))
+	#error "DISP_TEXT_MODE cannot be used with DISP_FAST_ISR, DISP_GRAYSCALE or DISP_PREFETCH"
+#endif
+
+// source descriptors
+// The displayed content is a sequence of up to DISP_SOURCE_COUNT sources. Each source
+// is a range of columns in the display memory, in flash or in EEPROM. Images are not
+// copied into the display memory but read by the display interrupt, so only text
+// and direct writes use RAM. Positions are counted across all sources (up to 255
+// columns). If all descriptors are used, images are copied as usual.
+// The display interrupt does not read from EEPROM while it is being written; such
+// columns stay dark.
+#if defined(DISP_SOURCES) && (defined(DISP_FAST_ISR) || defined(DISP_GRAYSCALE) || defined(DISP_PREFETCH) || defined(DISP_TEXT_MODE) || defined(DISP_GRAPHICS))
+	#error "DISP_SOURCES cannot be used with DISP_FAST_ISR, DISP_GRAYSCALE, DISP_PREFETCH, DISP_TEXT_MODE or DISP_GRAPHICS"
+#endif
+
+// shift register extension
+// Further modules can be chained to the right of the dot matrix. Their rows are wired
+// in parallel to the rows of the dot matrix and their columns are driven by a chain of
+// 74HC595 shift registers on pins that the dot matrix leaves free. The window is
+// DISP_WIDTH columns wide: the first DISP_COLUMNS columns are shown on the dot matrix,
+// the others on the modules (output Q0 of the first shift register = column
+// DISP_COLUMNS + 1). With row scanning every row step shifts out one bit per module
+// column while the previous row is still shown and then latches all of them at once.
+// The shift-out is unrolled to 4 port instructions per bit (8 to 9 cycles per column
+// as counted from the instructions). Its duration is measured with timer 1 if timer 1
+// is running (see dmReadShiftCycles).
+// With DISP_ANTI_GHOST all rows are switched off before the modules are latched, so
+// the new module columns never show with the previous row (2 more port writes per row).
+// Note: A row line carries the current of up to DISP_WIDTH leds, far more than a port
+// pin can drive. Every row needs an external non-inverting driver between the pin and
+// the shared row line: With DISP_TYPE 0 the selected row pin is high and the driver
+// sources the row current (e.g. UDN2981), with DISP_TYPE 1 the selected row pin is low
+// and the driver sinks it. An inverting driver (e.g. ULN2803 or a single transistor)
+// needs the opposite DISP_TYPE for the rows, which the output tables do not support.
+#define SR_DATA_PORT		PORTB		// serial data (DS) of the first shift register
+#define SR_DATA_DDR			DDRB
+#define SR_DATA				0
+#define SR_CLOCK_PORT		PORTB		// shift clock (SH_CP) of all shift registers
+#define SR_CLOCK_DDR		DDRB
+#define SR_CLOCK			7
+#define SR_LATCH_PORT		PORTD		// storage clock (ST_CP) of all shift registers
+#define SR_LATCH_DDR		DDRD
+#define SR_LATCH			5
+#if defined(DISP_SHIFT_OUT) && !defined(DISP_ROW_SCAN)
+	#error "DISP_SHIFT_OUT requires DISP_ROW_SCAN"
+#endif
+#if defined(DISP_SHIFT_OUT) && (defined(DISP_ORIENTATION) || defined(DISP_UPDOWN))
+	#error "DISP_SHIFT_OUT cannot be used with DISP_ORIENTATION or DISP_UPDOWN (the modules are not mirrored)"
+#endif
+#if defined(DISP_SHIFT_OUT) && (defined(DISP_RUNTIME_MATRIX) || defined(DISP_SOURCES)) && !defined(HAL_LARGE_MEMORY)
+	#error "DISP_SHIFT_OUT cannot be used with DISP_RUNTIME_MATRIX or DISP_SOURCES (not enough RAM)"
+#endif
+#if defined(DISP_SHIFT_OUT) && ((DISP_WIDTH <= DISP_COLUMNS) || (DISP_WIDTH > DISP_COLUMNS + 32))
+	#error "DISP_WIDTH out of range"
+#endif
+
+// ring buffer
+// The display memory holds a window of DISP_MAX columns that moves along with the
+// scrolling. Column positions are counted from the start of the content (up to
+// 65535) and stored at position modulo DISP_MAX. A renderer appends the columns of
+// a message while the area behind the visible window is freed by scrolling, so a
+// message can be much longer than the display memory (see dmRingFree).
+// The ring state tells the scrolling what happens at the end of the content:
+// While the renderer is filling the ring, scrolling waits for more columns. When
+// the content is complete, scrolling restarts at its first column if that is still
+// in the ring. Otherwise the renderer is asked to start over (RING_REFILL) or, for
+// content without renderer (e. g. serial input), the oldest columns are shown.
+// Only forward scrolling is supported in ring mode.
+#define RING_STATIC			0			// content is written once (no renderer)
+#define RING_FILL			1			// renderer is appending columns
+#define RING_COMPLETE		2			// renderer has finished the content
+#define RING_REFILL			3			// restart requested: renderer has to start over
+#if defined(DISP_RING) && (defined(DISP_FAST_ISR) || defined(DISP_GRAYSCALE) || defined(DISP_PREFETCH) || defined(DISP_TEXT_MODE) || defined(DISP_SOURCES) || defined(DISP_GRAPHICS))
+	#error "DISP_RING cannot be used with DISP_FAST_ISR, DISP_GRAYSCALE, DISP_PREFETCH, DISP_TEXT_MODE, DISP_SOURCES or DISP_GRAPHICS"
+#endif
+
+// layers
+// An image in flash can be shown as background layer behind the display content. The
+// display interrupt reads the background column from flash and combines it with the
+// content column, so no combined frames have to be rendered. The background has its
+// own window position and scrolling (see dmScrollBackground) and is repeated endlessly.
+#define LAYER_OR			0			// content and background are overlaid
+#define LAYER_XOR			1			// content inverts the background
+#define LAYER_MASK			2			// content is cut out of the background
+#if defined(DISP_LAYERS) && (defined(DISP_FAST_ISR) || defined(DISP_GRAYSCALE) || defined(DISP_PREFETCH))
+	#error "DISP_LAYERS cannot be used with DISP_FAST_ISR, DISP_GRAYSCALE or DISP_PREFETCH"
+#endif
+
+// padding
+// The scrolling range can include a number of blank columns before and after the
+// display content which are not stored in the display memory, so that messages need
+// no leading and trailing spaces to scroll in from the edge and out again.
+// The window position counts from the first blank column.
+#if defined(DISP_PAD) && (defined(DISP_FAST_ISR) || defined(DISP_GRAYSCALE) || defined(DISP_TEXT_MODE) || defined(DISP_SOURCES) || defined(DISP_RING))
+	#error "DISP_PAD cannot be used with DISP_FAST_ISR, DISP_GRAYSCALE, DISP_TEXT_MODE, DISP_SOURCES or DISP_RING"
+#endif
+
+// attributes
+// Up to DISP_ATTR_COUNT regions of the display memory can be shown inverted, blinking
+// or hidden. The display interrupt applies the attributes when it reads a column, so
+// the content itself is not changed. Blinking is counted in frames: the region is
+// dark while the bit of the frame counter selected by the blink rate is set.
+#define ATTR_INVERT			0x01		// region is shown inverted
+#define ATTR_HIDE			0x02		// region is dark
+#define ATTR_BLINK(rate)	((rate) << 4)	// region blinks (rate 1..4, 1 = every 256 frames, 4 = every 32 frames)
+#define ATTR_BLINK_MAX		4				// fastest rate (faster blinking would look like flicker)
+#if defined(DISP_ATTRIBUTES) && (defined(DISP_FAST_ISR) || defined(DISP_GRAYSCALE) || defined(DISP_PREFETCH) || defined(DISP_TEXT_MODE) || defined(DISP_RING))
+	#error "DISP_ATTRIBUTES cannot be used with DISP_FAST_ISR, DISP_GRAYSCALE, DISP_PREFETCH, DISP_TEXT_MODE or DISP_RING"
+#endif
+
+// vertical scrolling
+// The display content is shifted by a number of rows when a column is read by the
+// display interrupt, so the content itself is not changed. The content rolls out of
+// the window and in again from the opposite side (like an odometer) and rests for
+// a delay whenever it is back at its original position (see dmScrollVertical).
+#define VSCROLL_OFF			0
+#define VSCROLL_UP			1			// content moves from bottom to top
+#define VSCROLL_DOWN		2			// content moves from top to bottom
+#if defined(DISP_VSCROLL) && (defined(DISP_FAST_ISR) || defined(DISP_GRAYSCALE) || defined(DISP_PREFETCH))
+	#error "DISP_VSCROLL cannot be used with DISP_FAST_ISR, DISP_GRAYSCALE or DISP_PREFETCH"
+#endif
+
+// drawing operations
+// Every column byte of the display memory is combined with the drawn data within
+// a mask of affected rows. In text mode the display memory holds characters, so
+// nothing is drawn.
+#define DRAW_OR				0			// set pixels
+#define DRAW_CLEAR			1			// clear pixels
+#define DRAW_XOR			2			// toggle pixels
+#define DRAW_AND			3			// keep pixels only where data is set
+#define DRAW_COPY			4			// replace pixels (transparent outside the mask)
 
 // scrolling directions
 #define FORWARD				0			// text moves from right to left
@@ -63,6 +397,7 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
 #define D					2			// do not change
 
 #if DOT_MATRIX_TYPE == Tx07-11
+	#define DISP_MATRIX		(DISP_TYPE * MATRIX_ANODE)	// default for DISP_RUNTIME_MATRIX
 	// columns
 	#define C1_PORT			D			// column 1 is connected to PD4 etc.
 	#define C1				4
@@ -91,6 +426,7 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
 	#define R7				1
 
 #elif DOT_MATRIX_TYPE == HDSP5403
+	#define DISP_MATRIX		(DISP_TYPE * MATRIX_ANODE | MATRIX_HDSP5403)
 	// columns
 	#define C1_PORT			B			// column 1 is connected to PB3 etc.
 	#define C1				3
@@ -122,18 +458,86 @@ Disclaimer:			This software is provided by the copyright holder "as is" and any
 	#error "Unknown dot matrix type"
 #endif
 
+// The connection map has to define the rows R1..R<DISP_ROWS> and the columns
+// C1..C<DISP_COLUMNS>. The output tables are generated for any size up to 8 x 8, but
+// the hand-tuned display interrupt and the pin maps of the runtime matrix types
+// (see dot_matrix.c) are written for 5 x 7.
+#if ((DISP_COLUMNS != 5) || (DISP_ROWS != 7)) && (defined(DISP_FAST_ISR) || defined(DISP_RUNTIME_MATRIX))
+	#error "DISP_FAST_ISR and DISP_RUNTIME_MATRIX require a display with 5 columns and 7 rows"
+#endif
+
 
 /**************
  * prototypes *
  **************/
 void dmInit(void);
-void dmDisplay(void);
+uint8_t dmDisplay(void);
 uint8_t dmScroll(void);
+#ifdef DISP_ORIENTATION
+void dmSetOrientation(uint8_t orient);
+#endif
+#ifdef DISP_RUNTIME_MATRIX
+void dmSetMatrix(uint8_t matrix);
+#endif
 void dmSetScrolling(uint8_t inc, uint8_t dir, uint8_t delay);
+#ifdef DISP_PAD
+void dmSetPadding(uint8_t pad);
+#endif
+#ifdef DISP_ATTRIBUTES
+uint8_t dmSetAttribute(disp_pos_t first, disp_pos_t count, uint8_t attr);
+void dmMarkAttribute(uint8_t attr);
+#endif
+#ifdef DISP_VSCROLL
+uint8_t dmScrollVertical(void);
+void dmSetVScrolling(uint8_t dir, uint8_t delay);
+#endif
+#ifdef DISP_LAYERS
+void dmScrollBackground(void);
+void dmSetBackground(const uint8_t* image, uint8_t inc);
+void dmSetLayerMode(uint8_t op);
+#endif
+void dmBlank(void);
+#ifdef DISP_BRIGHTNESS
+void dmSetBrightness(uint8_t on_time);
+#endif
+#ifdef DISP_ENERGY_CAP
+uint32_t dmReadEnergy(uint8_t clear);
+#endif
+#ifdef DISP_SHIFT_OUT
+uint16_t dmReadShiftCycles(uint8_t clear);
+#endif
 void dmClearDisplay(void);
+void dmBeginUpdate(void);
+void dmCommit(void);
+#ifdef DISP_PREFETCH
+uint8_t dmBeginPrefetch(void);
+uint8_t dmEndPrefetch(void);
+void dmFlip(void);
+#endif
+#ifdef DISP_RING
+uint8_t dmRingFree(void);
+uint8_t dmRingState(void);
+void dmSetRingState(uint8_t state);
+#endif
 void dmDisplayImage(const uint8_t* image);
+#ifdef DISP_SOURCES
+uint8_t* dmDisplayEEImage(uint8_t* ee_adr);
+#endif
+#ifdef DISP_GRAYSCALE
+void dmDisplayGrayImage(const uint8_t* image);
+#endif
 void dmPrintByte(uint8_t byt);
 void dmPrintChar(uint8_t ch);
+#ifdef DISP_TEXT_MODE
+void dmSetTextMode(void);
+#endif
+#ifdef DISP_GRAPHICS
+void dmFillRect(int16_t x, int8_t y, uint8_t w, uint8_t h, uint8_t op);
+void dmBlit(int16_t x, int8_t y, const uint8_t* sprite, const uint8_t* mask, uint8_t op);
+#define dmDrawPixel(x, y, op)			dmFillRect((x), (y), 1, 1, (op))
+#define dmDrawHLine(x, y, len, op)		dmFillRect((x), (y), (len), 1, (op))
+#define dmDrawVLine(x, y, len, op)		dmFillRect((x), (y), 1, (len), (op))
+#endif
 
 // The following function was commented out to save flash memory.
 // Uncomment it if you want to use it.
@@ -0,0 +1,106 @@
+/*
+ * hal.h
+ *
+ */
+
+/**********************************************************************************
+
+Description:		Hardware abstraction of the supported controllers.
+Author:				Frank Andre
+License:			This software is distributed under the creative commons license
+					CC-BY-NC-SA.
+Disclaimer:			This software is provided by the copyright holder "as is" and any
+					express or implied warranties, including, but not limited to, the
+					implied warranties of merchantability and fitness for a particular
+					purpose are disclaimed. In no event shall the copyright owner or
+					contributors be liable for any direct, indirect, incidental,
+					special, exemplary, or consequential damages (including, but not
+					limited to, procurement of substitute goods or services; loss of
+					use, data, or profits; or business interruption) however caused
+					and on any theory of liability, whether in contract, strict
+					liability, or tort (including negligence or otherwise) arising
+					in any way out of the use of this software, even if advised of
+					the possibility of such damage.
+
+**********************************************************************************/
+
+
+#ifndef HAL_H_
+#define HAL_H_
+
+
+/*************
+ * constants *
+ *************/
+
+// The firmware is written for the ATtiny4313. For other controllers the registers,
+// bits and interrupt vectors are mapped to the names of the ATtiny4313 here, except
+// for the timer interrupt registers which are shared by both timers on the ATtiny4313.
+// The controller is selected by MCU in the Makefile.
+// All controllers run at 4 MHz, so the timing constants in config.h do not change.
+
+#if defined(__AVR_ATtiny4313__)
+
+	// timer interrupt mask and flag registers
+	#define TIMER0_IMSK		TIMSK
+	#define TIMER1_IMSK		TIMSK
+	#define TIMER1_IFR		TIFR
+
+	// fuses: internal 4 MHz oscillator
+	#define FUSE_LOW		0xE2
+	#define FUSE_HIGH		0xDF
+	#define FUSE_EXTENDED	0xFF
+	#define CLOCK_INIT()
+
+#elif defined(__AVR_ATmega328P__)
+
+	// 2 KB of RAM and 1 KB of EEPROM (see DISP_MAX in dot_matrix.h and MSG_SIZE in config.h)
+	#define HAL_LARGE_MEMORY
+
+	// The pins PA0 and PA1 of the dot matrix are connected to PC0 and PC1. All other
+	// pins of the dot matrix, the push button (PD6) and the serial interface (PD0, PD1)
+	// are the same.
+	#define PORTA			PORTC
+	#define DDRA			DDRC
+	#define PINA			PINC
+
+	// timer interrupt mask and flag registers
+	#define TIMER0_IMSK		TIMSK0
+	#define TIMER1_IMSK		TIMSK1
+	#define TIMER1_IFR		TIFR1
+
+	// USART 0
+	#define UBRRL			UBRR0L
+	#define UBRRH			UBRR0H
+	#define UCSRA			UCSR0A
+	#define UCSRB			UCSR0B
+	#define UCSRC			UCSR0C
+	#define UDR				UDR0
+	#define RXCIE			RXCIE0
+	#define RXEN			RXEN0
+	#define TXEN			TXEN0
+	#define UCSZ0			UCSZ00
+	#define UDRE			UDRE0
+	#define TXC				TXC0
+	#define FE				FE0
+	#define USART0_RX_vect	USART_RX_vect
+
+	// pin change interrupt of port D
+	#define GIMSK			PCICR
+	#define GIFR			PCIFR
+	#define PCINT_D_vect	PCINT2_vect
+
+	// fuses: internal 8 MHz oscillator, divided by 2 at startup (see CLOCK_INIT)
+	// clock_prescale_set keeps the timed sequence of CLKPR writes within 4 cycles.
+	#include <avr/power.h>
+	#define FUSE_LOW		0xE2
+	#define FUSE_HIGH		0xD9
+	#define FUSE_EXTENDED	0xFF
+	#define CLOCK_INIT()	clock_prescale_set(clock_div_2)
+
+#else
+	#error "Unsupported controller (see hal.h)"
+#endif
+
+
+#endif /* HAL_H_ */